@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
-#include <sys/time.h>
+#include <string>
+#include "../bench.h"
 
 using namespace std;
 
@@ -10,12 +11,6 @@ constexpr int matrix_size = 1024;
 Matrix matrix_A(matrix_size, vector<int>(matrix_size));
 Matrix matrix_B(matrix_size, vector<int>(matrix_size));
 
-double get_time() {
-    struct timeval tv;
-    gettimeofday(&tv, nullptr);
-    return tv.tv_sec + 1e-6 * tv.tv_usec;
-}
-
 Matrix generateRandomMatrix(int size) {
     srand(static_cast<unsigned int>(time(0)));
     Matrix matrix(size, vector<int>(size)); // 2D -  vector
@@ -110,12 +105,8 @@ void printMatrix(const Matrix& mat) {
 int main()
 {
     init(matrix_size);
-    float avg_time = 0.0f;
-    for (int K = 0; K < 5; K++) {
-        auto t = get_time();
-        StrassenAlgorithm(matrix_A, matrix_B);
-        avg_time += get_time() - t;
-    }
-    printf("Avg Time for Calculation Strassen: %f for n size %d \n", avg_time / 5, matrix_size);
+    bench_report(benchmark("strassen", "n=" + to_string(matrix_size), [] { StrassenAlgorithm(matrix_A, matrix_B); },
+                           matmul_flops(matrix_size, matrix_size, matrix_size),
+                           matmul_bytes(matrix_size, matrix_size, matrix_size, sizeof(int)), bench_options(0, 5)));
     return 0;
 }
\ No newline at end of file
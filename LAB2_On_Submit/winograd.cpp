@@ -3,15 +3,10 @@
 #include <cstdlib>
 #include <ctime>
 #include <stdlib.h>
-#include <sys/time.h>
+#include <string>
+#include "../bench.h"
 using namespace std;
 
-double get_time() {
-    struct timeval tv;
-    gettimeofday(&tv, nullptr);
-    return tv.tv_sec + 1e-6 * tv.tv_usec;
-}
-
 void im2col(const float* input, int batch_size, int height, int width, int channels,
             int kernel_size, int stride, int padding,
             vector<float>& output)
@@ -161,38 +156,31 @@ int main()
     vector<float> im2col_data;
     im2col(input.data(), batch_size, height, width, channels, kernel_size, stride, padding, im2col_data); // Perform im2col
 
+    int out_height = (height + 2 * padding - kernel_size) / stride + 1;
+    int out_width = (width + 2 * padding - kernel_size) / stride + 1;
+    string config = to_string(height) + "x" + to_string(width) + " " + to_string(channels) + "->" + to_string(out_channels);
     vector<float> output_normal;
-    double sum_normal = 0.0;
     cout << "im2col convert output size:" << im2col_data.size() << endl;
-    for (int i = 0; i < k; ++i)
-    {
-        auto t = get_time();
+    BenchResult normal = bench_report(benchmark("conv_gemm", config, [&] {
         convolution(im2col_data, batch_size, kernels, out_channels, kernel_size,
-                (height + 2 * padding - kernel_size) / stride + 1,
-                (width + 2 * padding - kernel_size) / stride + 1,
+                out_height, out_width,
                 output_normal);     // Perform convolution
-        sum_normal += get_time() - t;
-    }
+    }, 0.0, 0.0, bench_options(0, k)));
 
     cout << "Normal Conv Output size: " << output_normal.size() << endl;
     cout << "Process Finished !" << endl;
 
     vector<float> output_winograd;
-    double sum_winograd = 0.0;
     cout << "im2col convert output size:" << im2col_data.size() << endl;
-    for (int i = 0; i < k; ++i)
-    {
-        auto t = get_time();
+    BenchResult winograd = bench_report(benchmark("conv_winograd", config, [&] {
         convolution_winograd(im2col_data, batch_size, kernels, out_channels, kernel_size,
-                             (height + 2 * padding - kernel_size) / stride + 1,
-                             (width + 2 * padding - kernel_size) / stride + 1,
+                             out_height, out_width,
                              output_winograd); // Perform Winograd
-        sum_winograd += get_time() - t;
-    }
+    }, 0.0, 0.0, bench_options(0, k)));
     cout << "Winograd Conv Output size: " << output_winograd.size() << endl;
     cout << "Process Finished !" << endl;
 
-    cout  << "Normal Conv Running: " << sum_normal / k << endl; // Output Running time
-    cout  << "Winograd Running: " << sum_winograd / k << endl; // Output Running time
+    cout  << "Normal Conv Running: " << normal.mean << endl; // Output Running time
+    cout  << "Winograd Running: " << winograd.mean << endl; // Output Running time
 
 }
@@ -1,15 +1,11 @@
 // g++ matmul.cpp -o matmul -std=c++17 -O3 -Wall && ./matmul
+// BENCH_REPS / BENCH_WARMUP / BENCH_OUTPUT=results.json|csv control the benchmark (see bench.h).
 
-#include <sys/time.h>
 #include <iostream>
 #include <cstring>
 #include <cassert>
-
-double get_time() {
-  struct timeval tv;
-  gettimeofday(&tv, nullptr);
-  return tv.tv_sec + 1e-6 * tv.tv_usec;
-}
+#include <string>
+#include "../../bench.h"
 
 constexpr int n = 512;
 int A[n][n];
@@ -43,6 +39,10 @@ void test() {
   }
 }
 
+const std::string config = "n=" + std::to_string(n);
+const double flops = matmul_flops(n, n, n);
+const double bytes = matmul_bytes(n, n, n, sizeof(int));
+
 void matmul() {
   memset(C, 0, sizeof(C));
   for (int i = 0; i < n; i++) {
@@ -99,18 +99,12 @@ void matmul_BT() {
 
 int main() {
   init();
-  float avg_time = 0.0f;
-  for (int K = 0; K < 32; K++) {
-    auto t = get_time();
+  benchmark_and_verify("matmul", config, [] {
     // matmul_ikj();
     // matmul(); 
     matmul_AT();
     // matmul_BT();
-    test();
-    printf("%f\n", get_time() - t);
-    avg_time += get_time() - t;
-  }
-  printf("Avg Time for Calculation: %f\n", avg_time / 32);
+  }, flops, bytes, test, bench_options(1, 32));
   return 0;
 }
 
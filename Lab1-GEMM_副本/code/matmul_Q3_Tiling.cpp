@@ -1,15 +1,11 @@
-// g++ matmul.cpp -o matmul -std=c++17 -O3 -Wall && ./matmul
+// g++ matmul_Q3_Tiling.cpp -o matmul -std=c++17 -O3 -Wall && ./matmul
+// BENCH_REPS / BENCH_WARMUP / BENCH_OUTPUT=results.json|csv control the benchmark (see bench.h).
 
-#include <sys/time.h>
 #include <iostream>
 #include <cstring>
 #include <cassert>
-
-double get_time() {
-  struct timeval tv;
-  gettimeofday(&tv, nullptr);
-  return tv.tv_sec + 1e-6 * tv.tv_usec;
-}
+#include <string>
+#include "../../bench.h"
 
 constexpr int n = 256;
 int A[n][n];
@@ -43,6 +39,10 @@ void test() {
   }
 }
 
+const std::string config = "n=" + std::to_string(n);
+const double flops = matmul_flops(n, n, n);
+const double bytes = matmul_bytes(n, n, n, sizeof(int));
+
 void matmul() {
   memset(C, 0, sizeof(C));
   for (int i = 0; i < n; i++) {
@@ -188,83 +188,35 @@ void matmul_BT_tiling(int size) {
 }
 
 void experiment_ijk(int size){
-    float avg_time = 0.0f;
-    for (int K = 0; K < 32; K++) {
-        auto t = get_time();
-        matmul_ikj();
-        test();
-        avg_time += get_time() - t;
-    }
-    printf("Avg Time for matmul_IJK Calculation: %f\n", avg_time / 32);
+    benchmark_and_verify("matmul_IJK", config, matmul_ikj,
+                         flops, bytes, test, bench_options(1, 32));
 
-    avg_time = 0.0f;
-    for (int K = 0; K < 32; K++) {
-        auto t = get_time();
-        matmul_ikj_tiling(size);
-        test();
-        avg_time += get_time() - t;
-    }
-    printf("Avg Time for matmul_IJK tiling Calculation: %f\n", avg_time / 32);
+    benchmark_and_verify("matmul_IJK tiling", config, [&] { matmul_ikj_tiling(size); },
+                         flops, bytes, test, bench_options(1, 32));
 }
 
 void experiment_matmul(int size){
-    float avg_time = 0.0f;
-    for (int K = 0; K < 32; K++) {
-        auto t = get_time();
-        matmul();
-        test();
-        avg_time += get_time() - t;
-    }
-    printf("Avg Time for matmul Calculation: %f\n", avg_time / 32);
+    benchmark_and_verify("matmul", config, matmul,
+                         flops, bytes, test, bench_options(1, 32));
 
-    avg_time = 0.0f;
-    for (int K = 0; K < 32; K++) {
-        auto t = get_time();
-        matmul_tiling(size);
-        test();
-        avg_time += get_time() - t;
-    }
-    printf("Avg Time for matmul tiling Calculation: %f\n", avg_time / 32);
+    benchmark_and_verify("matmul tiling", config, [&] { matmul_tiling(size); },
+                         flops, bytes, test, bench_options(1, 32));
 }
 
 void experiment_AT(int size){
-    float avg_time = 0.0f;
-    for (int K = 0; K < 32; K++) {
-        auto t = get_time();
-        matmul_AT();
-        test();
-        avg_time += get_time() - t;
-    }
-    printf("Avg Time for AT Calculation: %f\n", avg_time / 32);
+    benchmark_and_verify("AT", config, matmul_AT,
+                         flops, bytes, test, bench_options(1, 32));
 
-    avg_time = 0.0f;
-    for (int K = 0; K < 32; K++) {
-        auto t = get_time();
-        matmul_AT_tiling(size);
-        test();
-        avg_time += get_time() - t;
-    }
-    printf("Avg Time for AT tiling Calculation: %f\n", avg_time / 32);
+    benchmark_and_verify("AT tiling", config, [&] { matmul_AT_tiling(size); },
+                         flops, bytes, test, bench_options(1, 32));
 }
 
 void experiment_BT(int size){
-    float avg_time = 0.0f;
-    for (int K = 0; K < 32; K++) {
-        auto t = get_time();
-        matmul_BT();
-        test();
-        avg_time += get_time() - t;
-    }
-    printf("Avg Time for BT Calculation: %f\n", avg_time / 32);
+    benchmark_and_verify("BT", config, matmul_BT,
+                         flops, bytes, test, bench_options(1, 32));
 
-    avg_time = 0.0f;
-    for (int K = 0; K < 32; K++) {
-        auto t = get_time();
-        matmul_BT_tiling(size);
-        test();
-        avg_time += get_time() - t;
-    }
-    printf("Avg Time for BT tiling Calculation: %f\n", avg_time / 32);
+    benchmark_and_verify("BT tiling", config, [&] { matmul_BT_tiling(size); },
+                         flops, bytes, test, bench_options(1, 32));
 }
 
 int main() {
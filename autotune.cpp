@@ -0,0 +1,272 @@
+//
+// Auto-tuner and on-disk tuning database for gemm().
+//
+
+#include "autotune.h"
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "bench.h"
+
+template <typename T> struct TypeName;
+template <> struct TypeName<int> { static constexpr const char* value = "int"; };
+template <> struct TypeName<float> { static constexpr const char* value = "float"; };
+
+using TuneKey = std::tuple<std::string, int, int, int>;
+
+struct TuneEntry {
+    GemmConfig config;
+    double seconds = 0.0;
+};
+
+using TuneDb = std::map<TuneKey, TuneEntry>;
+
+static std::mutex db_mutex;
+
+// Immutable copy of the database that gemm() reads without locking. A new one is
+// published after every tuning run; every one published stays alive, since
+// readers may still hold them (tuning runs are rare)
+static std::atomic<const TuneDb*> db_snapshot{nullptr};
+static std::vector<std::unique_ptr<const TuneDb>> snapshots;
+
+std::string tuning_db_path() {
+    const char* path = std::getenv("GEMM_TUNE_DB");
+    return path && *path ? path : "gemm_tune.txt";
+}
+
+static bool parse_order(const std::string& name, LoopOrder& order) {
+    for (LoopOrder o : {LoopOrder::IJK, LoopOrder::IKJ, LoopOrder::AT, LoopOrder::BT}) {
+        if (name == loop_order_name(o)) {
+            order = o;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Loaded on first use and kept in memory; callers hold db_mutex
+static TuneDb& tuning_db() {
+    static TuneDb db;
+    static bool loaded = false;
+    if (loaded) {
+        return db;
+    }
+    loaded = true;
+    std::ifstream file(tuning_db_path());
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream in(line);
+        std::string type, kind;
+        int M, N, K;
+        TuneEntry entry;
+        if (!(in >> type >> M >> N >> K >> kind)) {
+            continue;
+        }
+        if (kind == "packed") {
+            entry.config.kind = GemmConfig::PACKED;
+            in >> entry.config.blocking.mc >> entry.config.blocking.kc >> entry.config.blocking.nc;
+        } else if (kind == "tiled") {
+            std::string order;
+            entry.config.kind = GemmConfig::TILED;
+            in >> order >> entry.config.tile >> entry.config.unroll;
+            if (!parse_order(order, entry.config.order)) {
+                continue;
+            }
+        } else {
+            continue;
+        }
+        if (in >> entry.seconds) {
+            db[TuneKey(type, M, N, K)] = entry;
+        }
+    }
+    return db;
+}
+
+static void save_tuning_db(const TuneDb& db) {
+    std::ofstream file(tuning_db_path(), std::ios::trunc);
+    file << "# type M N K packed mc kc nc seconds | type M N K tiled order tile unroll seconds\n";
+    for (const auto& [key, entry] : db) {
+        const auto& [type, M, N, K] = key;
+        file << type << " " << M << " " << N << " " << K << " ";
+        const GemmConfig& c = entry.config;
+        if (c.kind == GemmConfig::PACKED) {
+            file << "packed " << c.blocking.mc << " " << c.blocking.kc << " " << c.blocking.nc;
+        } else {
+            file << "tiled " << loop_order_name(c.order) << " " << c.tile << " " << c.unroll;
+        }
+        file << " " << entry.seconds << "\n";
+    }
+}
+
+// Callers hold db_mutex
+static const TuneDb* publish_snapshot(const TuneDb& db) {
+    snapshots.push_back(std::make_unique<const TuneDb>(db));
+    const TuneDb* snapshot = snapshots.back().get();
+    db_snapshot.store(snapshot, std::memory_order_release);
+    return snapshot;
+}
+
+// Lock-free after the first call; the mutex is only taken to load the file
+template <typename T>
+bool find_tuned_config(int M, int N, int K, GemmConfig& config) {
+    const TuneDb* db = db_snapshot.load(std::memory_order_acquire);
+    if (!db) {
+        std::lock_guard<std::mutex> lock(db_mutex);
+        db = db_snapshot.load(std::memory_order_relaxed);
+        if (!db) {
+            db = publish_snapshot(tuning_db());
+        }
+    }
+    auto it = db->find(TuneKey(TypeName<T>::value, M, N, K));
+    if (it == db->end()) {
+        return false;
+    }
+    config = it->second.config;
+    return true;
+}
+
+static long cache_size(int name, long fallback) {
+    long size = sysconf(name);
+    return size > 0 ? size : fallback;
+}
+
+// Best of `reps` runs after one warmup
+template <typename T>
+static double time_config(const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& C, const GemmConfig& config, int reps) {
+    return benchmark("gemm", "", [&] { gemm(A, B, C, config); }, 0.0, 0.0, BenchOptions{1, reps}).min;
+}
+
+static void print_config(const GemmConfig& c, double seconds) {
+    if (c.kind == GemmConfig::PACKED) {
+        printf("  packed mc=%-4d kc=%-4d nc=%-5d : %f s\n", c.blocking.mc, c.blocking.kc, c.blocking.nc, seconds);
+    } else {
+        printf("  tiled  %-3s tile=%-4d unroll=%d   : %f s\n", loop_order_name(c.order), c.tile, c.unroll, seconds);
+    }
+}
+
+static int floor_pow2(long value) {
+    int p = 1;
+    while (2L * p <= value) {
+        p *= 2;
+    }
+    return p;
+}
+
+template <typename T>
+GemmConfig gemm_autotune(int M, int N, int K, bool verbose) {
+    Matrix<T> A(M, K);
+    Matrix<T> B(K, N);
+    Matrix<T> C(M, N);
+    for (int i = 0; i < M; ++i) {
+        for (int k = 0; k < K; ++k) {
+            A(i, k) = static_cast<T>(rand() % 100);
+        }
+    }
+    for (int k = 0; k < K; ++k) {
+        for (int j = 0; j < N; ++j) {
+            B(k, j) = static_cast<T>(rand() % 100);
+        }
+    }
+
+    long l1 = cache_size(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+    long l2 = cache_size(_SC_LEVEL2_CACHE_SIZE, 1024 * 1024);
+    long l3 = std::min(cache_size(_SC_LEVEL3_CACHE_SIZE, 8 * 1024 * 1024), 32L * 1024 * 1024);
+    int reps = 3;
+
+    GemmConfig best;
+    double best_time = 1e30;
+    auto consider = [&](const GemmConfig& config, int repeats) {
+        double t = time_config(A, B, C, config, repeats);
+        if (verbose) {
+            print_config(config, t);
+        }
+        if (t < best_time) {
+            best_time = t;
+            best = config;
+        }
+        return t;
+    };
+
+    // Packed: start from the cache-derived blocking, then walk kc, mc and nc in turn
+    GemmConfig packed;
+    packed.blocking.kc = floor_pow2(l1 / 2 / (16 * sizeof(T)));           // kc x NR micro-panel in half of L1
+    packed.blocking.mc = floor_pow2(l2 / 2 / (packed.blocking.kc * sizeof(T))); // mc x kc block in half of L2
+    packed.blocking.nc = floor_pow2(l3 / 2 / (packed.blocking.kc * sizeof(T))); // kc x nc panel in half of L3
+    consider(packed, reps);
+    for (int GemmBlocking::*field : {&GemmBlocking::kc, &GemmBlocking::mc, &GemmBlocking::nc}) {
+        GemmConfig center = best;
+        for (int scale : {-1, 1}) {
+            GemmConfig candidate = center;
+            int& value = candidate.blocking.*field;
+            value = scale < 0 ? value / 2 : value * 2;
+            if (value >= 16) {
+                consider(candidate, reps);
+            }
+        }
+    }
+
+    // Tiled: one tile size per cache level (three size x size tiles resident) plus the classic 32
+    std::vector<int> tiles = {32};
+    for (long cache : {l1, l2, l3}) {
+        long elements = cache / 3 / static_cast<long>(sizeof(T));
+        int tile = 8;
+        while (static_cast<long>(tile + 8) * (tile + 8) <= elements) {
+            tile += 8;
+        }
+        tiles.push_back(std::min(tile, std::max({M, N, K})));
+    }
+    std::sort(tiles.begin(), tiles.end());
+    tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+
+    // One run each to prune, then the fastest few are re-timed with `reps` like the packed
+    // candidates, so both kinds compete on the same best-of-reps measure
+    std::vector<std::pair<double, GemmConfig>> tiled_runs;
+    for (LoopOrder order : {LoopOrder::IJK, LoopOrder::IKJ, LoopOrder::AT, LoopOrder::BT}) {
+        for (int tile : tiles) {
+            for (int unroll : {1, 2, 4, 8}) {
+                GemmConfig tiled;
+                tiled.kind = GemmConfig::TILED;
+                tiled.order = order;
+                tiled.tile = tile;
+                tiled.unroll = unroll;
+                tiled_runs.emplace_back(time_config(A, B, C, tiled, 1), tiled);
+            }
+        }
+    }
+    std::sort(tiled_runs.begin(), tiled_runs.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    const size_t tiled_finalists = 4;
+    for (size_t i = 0; i < std::min(tiled_finalists, tiled_runs.size()); ++i) {
+        consider(tiled_runs[i].second, reps);
+    }
+
+    if (verbose) {
+        printf("Best for %s %d x %d x %d:\n", TypeName<T>::value, M, N, K);
+        print_config(best, best_time);
+    }
+
+    std::lock_guard<std::mutex> lock(db_mutex);
+    auto& db = tuning_db();
+    db[TuneKey(TypeName<T>::value, M, N, K)] = {best, best_time};
+    save_tuning_db(db);
+    publish_snapshot(db);
+    return best;
+}
+
+template bool find_tuned_config<int>(int, int, int, GemmConfig&);
+template bool find_tuned_config<float>(int, int, int, GemmConfig&);
+template GemmConfig gemm_autotune<int>(int, int, int, bool);
+template GemmConfig gemm_autotune<float>(int, int, int, bool);
@@ -0,0 +1,27 @@
+//
+// Auto-tuner and on-disk tuning database for gemm().
+//
+
+#pragma once
+
+#include "gemm.h"
+#include <string>
+
+// Text file with one line per tuned (type, M, N, K):
+//   int 1024 1024 1024 packed <mc> <kc> <nc> <seconds>
+//   int 1024 1024 1024 tiled <ijk|ikj|AT|BT> <tile> <unroll> <seconds>
+// Taken from $GEMM_TUNE_DB, or gemm_tune.txt in the working directory.
+std::string tuning_db_path();
+
+// Tuned configuration of an M x N x K problem; returns false (config untouched) if there is none.
+// Reads an immutable snapshot of the database, so gemm() calls never contend on a lock
+template <typename T>
+bool find_tuned_config(int M, int N, int K, GemmConfig& config);
+
+// Time every candidate on random M x K and K x N operands on this host:
+//   packed : kc / mc / nc derived from the L1 / L2 / L3 sizes, halved and doubled
+//   tiled  : ijk / ikj / AT / BT x per-cache-level tile sizes x unroll 1, 2, 4, 8,
+//            pruned on one run each; the fastest four are re-timed like the packed ones
+// The fastest is written to the tuning database and returned.
+template <typename T>
+GemmConfig gemm_autotune(int M, int N, int K, bool verbose = false);
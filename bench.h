@@ -0,0 +1,172 @@
+//
+// Benchmark harness shared by every kernel.
+//
+// benchmark()   : warmup runs, then timed repetitions on a monotonic clock;
+//                 reports min / median / p95 / mean / stddev and GFLOP/s, GB/s
+//                 derived from the problem's flop and byte counts (at the median).
+// bench_report(): prints one line and records the result; bench_write() dumps
+//                 every recorded result as JSON or CSV (by file extension).
+//                 With BENCH_OUTPUT=<file> set this happens at exit.
+// benchmark_and_verify(): benchmark() + bench_report(), then a check of the
+//                 result outside the timed region.
+// BENCH_WARMUP / BENCH_REPS override the default warmup and repetition counts.
+//
+// Header-only so the standalone lab programs can use it without extra sources.
+//
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Seconds on a monotonic high-resolution clock
+inline double bench_now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct BenchOptions {
+    int warmup = 1;       // Untimed runs before the first sample
+    int repetitions = 10; // Timed runs
+};
+
+// Given defaults, overridden by BENCH_WARMUP / BENCH_REPS
+inline BenchOptions bench_options(int warmup = 1, int repetitions = 10) {
+    BenchOptions options{warmup, repetitions};
+    if (const char* env = std::getenv("BENCH_WARMUP")) options.warmup = std::max(0, std::atoi(env));
+    if (const char* env = std::getenv("BENCH_REPS")) options.repetitions = std::max(1, std::atoi(env));
+    return options;
+}
+
+struct BenchResult {
+    std::string name;
+    std::string config;          // Problem shape / parameters, free-form
+    std::vector<double> samples; // Seconds per run, sorted
+    double min = 0.0, median = 0.0, p95 = 0.0, mean = 0.0, stddev = 0.0;
+    double flops = 0.0;          // Work per run
+    double bytes = 0.0;          // Compulsory traffic per run (inputs read + output written)
+
+    double gflops() const { return median > 0.0 ? flops / median * 1e-9 : 0.0; }
+    double gbps() const { return median > 0.0 ? bytes / median * 1e-9 : 0.0; }
+};
+
+// Sort the samples and fill in the order statistics (p95 by nearest rank)
+inline void bench_summarize(BenchResult& result) {
+    std::vector<double>& s = result.samples;
+    if (s.empty()) return;
+    std::sort(s.begin(), s.end());
+    size_t n = s.size();
+    result.min = s.front();
+    result.median = n % 2 ? s[n / 2] : 0.5 * (s[n / 2 - 1] + s[n / 2]);
+    result.p95 = s[static_cast<size_t>(std::ceil(0.95 * n)) - 1];
+    double sum = 0.0;
+    for (double x : s) sum += x;
+    result.mean = sum / n;
+    double var = 0.0;
+    for (double x : s) var += (x - result.mean) * (x - result.mean);
+    result.stddev = n > 1 ? std::sqrt(var / (n - 1)) : 0.0;
+}
+
+// Work and compulsory traffic of an (m x k) * (k x n) product: 2 m n k flops, A and B read
+// once and C written once. Reuse through the caches is not counted
+inline double matmul_flops(double m, double n, double k) { return 2.0 * m * n * k; }
+inline double matmul_bytes(double m, double n, double k, double element_size) {
+    return element_size * (m * k + k * n + m * n);
+}
+
+// Time fn(); anything that must not be measured (verification, setup) stays outside it
+template <typename Fn>
+BenchResult benchmark(const std::string& name, const std::string& config, Fn&& fn,
+                      double flops = 0.0, double bytes = 0.0, const BenchOptions& options = bench_options()) {
+    BenchResult result;
+    result.name = name;
+    result.config = config;
+    result.flops = flops;
+    result.bytes = bytes;
+    for (int i = 0; i < options.warmup; ++i) fn();
+    result.samples.reserve(options.repetitions);
+    for (int i = 0; i < options.repetitions; ++i) {
+        double t = bench_now();
+        fn();
+        result.samples.push_back(bench_now() - t);
+    }
+    bench_summarize(result);
+    return result;
+}
+
+// JSON escapes quotes and backslashes, CSV doubles quotes
+inline std::string bench_escape(const std::string& s, bool csv) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || (!csv && c == '\\')) out += csv ? '"' : '\\';
+        out += c;
+    }
+    return out;
+}
+
+// All results as a JSON array (path ending in .json) or CSV with a header row (anything else)
+inline bool bench_write(const std::string& path, const std::vector<BenchResult>& results) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (!json) fprintf(file, "name,config,reps,min_s,median_s,p95_s,mean_s,stddev_s,gflops,gbps\n");
+    else fprintf(file, "[\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        if (json) {
+            fprintf(file, "  {\"name\": \"%s\", \"config\": \"%s\", \"reps\": %zu, \"min_s\": %.9g, \"median_s\": %.9g, "
+                          "\"p95_s\": %.9g, \"mean_s\": %.9g, \"stddev_s\": %.9g, \"gflops\": %.6g, \"gbps\": %.6g}%s\n",
+                    bench_escape(r.name, false).c_str(), bench_escape(r.config, false).c_str(), r.samples.size(), r.min,
+                    r.median, r.p95, r.mean, r.stddev, r.gflops(), r.gbps(), i + 1 < results.size() ? "," : "");
+        } else {
+            fprintf(file, "\"%s\",\"%s\",%zu,%.9g,%.9g,%.9g,%.9g,%.9g,%.6g,%.6g\n", bench_escape(r.name, true).c_str(),
+                    bench_escape(r.config, true).c_str(), r.samples.size(), r.min, r.median, r.p95, r.mean, r.stddev,
+                    r.gflops(), r.gbps());
+        }
+    }
+    if (json) fprintf(file, "]\n");
+    return std::fclose(file) == 0;
+}
+
+// Process-wide record of reported results; written to BENCH_OUTPUT (if set) at exit
+struct BenchRegistry {
+    std::vector<BenchResult> results;
+
+    ~BenchRegistry() {
+        const char* path = std::getenv("BENCH_OUTPUT");
+        if (path && !results.empty() && !bench_write(path, results)) {
+            fprintf(stderr, "bench: cannot write %s\n", path);
+        }
+    }
+};
+
+inline BenchRegistry& bench_registry() {
+    static BenchRegistry registry;
+    return registry;
+}
+
+inline bool bench_write(const std::string& path) { return bench_write(path, bench_registry().results); }
+
+// One human-readable line on stdout; the result is kept for bench_write()
+inline const BenchResult& bench_report(BenchResult result) {
+    printf("%s [%s]: median %f s, min %f, p95 %f, stddev %f (%zu reps)", result.name.c_str(), result.config.c_str(),
+           result.median, result.min, result.p95, result.stddev, result.samples.size());
+    if (result.flops > 0.0) printf(", %.2f GFLOP/s", result.gflops());
+    if (result.bytes > 0.0) printf(", %.2f GB/s", result.gbps());
+    printf("\n");
+    bench_registry().results.push_back(std::move(result));
+    return bench_registry().results.back();
+}
+
+// Time fn() and report it, then run verify() on the result outside the timed region
+template <typename Fn, typename Verify>
+const BenchResult& benchmark_and_verify(const std::string& name, const std::string& config, Fn&& fn, double flops,
+                                        double bytes, Verify&& verify, const BenchOptions& options = bench_options()) {
+    const BenchResult& result = bench_report(benchmark(name, config, fn, flops, bytes, options));
+    verify();
+    return result;
+}
@@ -0,0 +1,395 @@
+//
+// Packed, register-blocked GEMM (GotoBLAS / BLIS style).
+//
+// Loop structure (jc, pc, ic, jr, ir):
+//   jc : nc-wide panels of B / C           (B panel lives in L3)
+//   pc : kc-deep slices of A and B         (packed once per slice)
+//   ic : mc-tall blocks of A               (A block lives in L2)
+//   jr : NR-wide micro-panels of packed B  (micro-panel lives in L1)
+//   ir : MR-tall micro-panels of packed A  (MR x NR tile of C in registers)
+//
+
+#include "gemm.h"
+#include "autotune.h"
+#include "gemm_kernels.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+GemmBlocking gemm_default_blocking() {
+    return {128, 256, 4096};
+}
+
+// Grow-only, 64-byte aligned scratch buffer (one per thread, reused across calls)
+template <typename T>
+struct PackBuffer {
+    T* data = nullptr;
+    size_t capacity = 0;
+
+    ~PackBuffer() { std::free(data); }
+
+    T* get(size_t count) {
+        if (count > capacity) {
+            std::free(data);
+            size_t bytes = (count * sizeof(T) + 63) / 64 * 64;
+            data = static_cast<T*>(std::aligned_alloc(64, bytes));
+            capacity = count;
+        }
+        return data;
+    }
+};
+
+// Pack an mc x kc block of A into MR-row micro-panels, column by column.
+// Rows past mc are zero-filled so the micro-kernel never needs a bound check.
+// Any strides are accepted here, which is how transposed views are handled.
+template <typename T>
+static void pack_A(MatrixView<const T> A, T* packed) {
+    int mc = A.rows;
+    int kc = A.cols;
+    for (int i = 0; i < mc; i += MR) {
+        int mr = std::min(MR, mc - i);
+        for (int k = 0; k < kc; ++k) {
+            for (int r = 0; r < mr; ++r) {
+                packed[r] = A(i + r, k);
+            }
+            for (int r = mr; r < MR; ++r) {
+                packed[r] = 0;
+            }
+            packed += MR;
+        }
+    }
+}
+
+// Pack a kc x nc panel of B into NR-col micro-panels, row by row.
+template <typename T>
+static void pack_B(MatrixView<const T> B, T* packed) {
+    int kc = B.rows;
+    int nc = B.cols;
+    for (int j = 0; j < nc; j += NR) {
+        int nr = std::min(NR, nc - j);
+        for (int k = 0; k < kc; ++k) {
+            if (B.col_stride == 1 && nr == NR) {
+                std::memcpy(packed, &B(k, j), NR * sizeof(T));
+                packed += NR;
+                continue;
+            }
+            for (int c = 0; c < nr; ++c) {
+                packed[c] = B(k, j + c);
+            }
+            for (int c = nr; c < NR; ++c) {
+                packed[c] = 0;
+            }
+            packed += NR;
+        }
+    }
+}
+
+// MR x NR register tile: C = a * b (or C += a * b) over kc packed steps.
+// Generic version used for float; int32 goes through the dispatched SIMD
+// kernels in gemm_simd.cpp. The tile is swept in NR_HALF-wide halves so the accumulators fit the
+// 16 baseline SSE registers.
+template <typename T>
+static void micro_kernel(int kc, const T* a, const T* b, T* C, int ldc, bool accumulate) {
+    constexpr int NR_HALF = NR / 2;
+    for (int h = 0; h < NR; h += NR_HALF) {
+        T acc[MR][NR_HALF] = {};
+        const T* pa = a;
+        const T* pb = b + h;
+        for (int k = 0; k < kc; ++k) {
+            for (int r = 0; r < MR; ++r) {
+                T ar = pa[r];
+                for (int c = 0; c < NR_HALF; ++c) {
+                    acc[r][c] += ar * pb[c];
+                }
+            }
+            pa += MR;
+            pb += NR;
+        }
+        for (int r = 0; r < MR; ++r) {
+            for (int c = 0; c < NR_HALF; ++c) {
+                T* out = C + r * ldc + h + c;
+                *out = accumulate ? *out + acc[r][c] : acc[r][c];
+            }
+        }
+    }
+}
+
+// Epilogue over the mr x nr tile at (i, j) of C; (row0, col0) places C in the whole product
+template <typename T>
+static void apply_epilogue(const GemmEpilogue& epilogue, MatrixView<T> C, int i, int j, int mr, int nr,
+                           int row0, int col0) {
+    for (int r = 0; r < mr; ++r) {
+        for (int cc = 0; cc < nr; ++cc) {
+            T& out = C(i + r, j + cc);
+            out = static_cast<T>(epilogue.apply(static_cast<float>(out), row0 + i + r, col0 + j + cc));
+        }
+    }
+}
+
+// Walk the packed mc x kc block of A against the packed kc x nc panel of B.
+// The epilogue (if any) is passed on the last k slice only.
+template <typename T>
+static void macro_kernel(int kc, const T* packed_A, const T* packed_B,
+                         MatrixView<T> C, bool accumulate, MicroKernel<T> kernel,
+                         const GemmEpilogue* epilogue = nullptr, int row0 = 0, int col0 = 0) {
+    alignas(64) T tile[MR * NR];
+    int mc = C.rows;
+    int nc = C.cols;
+    bool unit_cols = C.col_stride == 1;
+    for (int j = 0; j < nc; j += NR) {
+        int nr = std::min(NR, nc - j);
+        for (int i = 0; i < mc; i += MR) {
+            int mr = std::min(MR, mc - i);
+            const T* a = packed_A + i * kc;
+            const T* b = packed_B + j * kc;
+            if (mr == MR && nr == NR && unit_cols) {
+                kernel(kc, a, b, &C(i, j), static_cast<int>(C.row_stride), accumulate);
+                if (epilogue) {
+                    apply_epilogue(*epilogue, C, i, j, MR, NR, row0, col0);
+                }
+                continue;
+            }
+            kernel(kc, a, b, tile, NR, false); // Edge or strided tile: compute full tile, store the valid part
+            for (int r = 0; r < mr; ++r) {
+                for (int cc = 0; cc < nr; ++cc) {
+                    T& out = C(i + r, j + cc);
+                    out = accumulate ? out + tile[r * NR + cc] : tile[r * NR + cc];
+                    if (epilogue) {
+                        out = static_cast<T>(epilogue->apply(static_cast<float>(out), row0 + i + r, col0 + j + cc));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Pack the kc x nc panel B(k0 .. k0 + kb, j0 .. j0 + nb) of an explicit B
+template <typename T>
+struct ViewPacker {
+    MatrixView<const T> B;
+
+    void operator()(int k0, int j0, int kb, int nb, T* packed) const {
+        pack_B(B.block(k0, j0, kb, nb), packed);
+    }
+};
+
+// Same micro-panel layout as pack_B, but every row segment of B comes from a
+// gather callback (implicit GEMM: B is never materialised)
+struct GatherPacker {
+    const GemmRowGather* gather;
+
+    void operator()(int k0, int j0, int kb, int nb, float* packed) const {
+        for (int j = 0; j < nb; j += NR) {
+            int nr = std::min(NR, nb - j);
+            for (int k = 0; k < kb; ++k) {
+                (*gather)(k0 + k, j0 + j, nr, packed);
+                for (int c = nr; c < NR; ++c) {
+                    packed[c] = 0;
+                }
+                packed += NR;
+            }
+        }
+    }
+};
+
+// C block whose (0, 0) is (i_offset, j_offset) of the whole product
+template <typename T, typename PackB>
+static void gemm_packed(MatrixView<const T> A, const PackB& pack_b, int i_offset, int j_offset, MatrixView<T> C,
+                        bool accumulate, GemmBlocking blocking, MicroKernel<T> kernel,
+                        const GemmEpilogue* epilogue) {
+    int M = C.rows;
+    int N = C.cols;
+    int K = A.cols;
+    if (M <= 0 || N <= 0) {
+        return;
+    }
+    if (K <= 0) {
+        if (!accumulate) {
+            for (int i = 0; i < M; ++i) {
+                for (int j = 0; j < N; ++j) {
+                    C(i, j) = 0;
+                }
+            }
+        }
+        if (epilogue) {
+            apply_epilogue(*epilogue, C, 0, 0, M, N, i_offset, j_offset);
+        }
+        return;
+    }
+
+    int mc = std::max(MR, blocking.mc / MR * MR);
+    int nc = std::max(NR, blocking.nc / NR * NR);
+    int kc = std::max(1, blocking.kc);
+
+    thread_local PackBuffer<T> buffer_A;
+    thread_local PackBuffer<T> buffer_B;
+    T* packed_A = buffer_A.get(static_cast<size_t>(mc) * kc);
+    T* packed_B = buffer_B.get(static_cast<size_t>(kc) * nc);
+
+    for (int jc = 0; jc < N; jc += nc) {
+        int nb = std::min(nc, N - jc);
+        for (int pc = 0; pc < K; pc += kc) {
+            int kb = std::min(kc, K - pc);
+            pack_b(pc, j_offset + jc, kb, nb, packed_B);
+            bool acc = accumulate || pc > 0; // Later k slices add onto the first one
+            const GemmEpilogue* last = pc + kb == K ? epilogue : nullptr;
+            for (int ic = 0; ic < M; ic += mc) {
+                int mb = std::min(mc, M - ic);
+                pack_A(A.block(ic, pc, mb, kb), packed_A);
+                macro_kernel(kb, packed_A, packed_B, C.block(ic, jc, mb, nb), acc, kernel,
+                             last, i_offset + ic, j_offset + jc);
+            }
+        }
+    }
+}
+
+// Problems below this many multiply-adds are not worth waking the pool for
+constexpr double PARALLEL_MIN_WORK = 64.0 * 64.0 * 64.0;
+
+static int round_up(int value, int multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Split C into a pm x pn grid of 2D macro-tiles, one per pool thread, and run the
+// packed GEMM loop nest on every tile. The grid is the factorisation of the thread
+// count whose tiles come closest to square, which keeps the A and B re-packing
+// done by each tile to a minimum.
+template <typename T, typename PackB>
+static void gemm_parallel(MatrixView<const T> A, const PackB& pack_b, MatrixView<T> C,
+                          bool accumulate, GemmBlocking blocking, MicroKernel<T> kernel,
+                          const GemmEpilogue* epilogue = nullptr) {
+    assert(A.rows == C.rows);
+    int M = C.rows;
+    int N = C.cols;
+    int K = A.cols;
+    ThreadPool& pool = global_thread_pool();
+    int threads = pool.size();
+    if (threads == 1 || static_cast<double>(M) * N * K < PARALLEL_MIN_WORK) {
+        gemm_packed(A, pack_b, 0, 0, C, accumulate, blocking, kernel, epilogue);
+        return;
+    }
+
+    int max_pm = (M + MR - 1) / MR;
+    int max_pn = (N + NR - 1) / NR;
+    int pm = 1;
+    int pn = 1;
+    long best = -1;
+    for (int cm = 1; cm <= threads; ++cm) {
+        if (threads % cm != 0 || cm > max_pm || threads / cm > max_pn) {
+            continue;
+        }
+        int cn = threads / cm;
+        long tile_m = (M + cm - 1) / cm;
+        long tile_n = (N + cn - 1) / cn;
+        long perimeter = tile_m + tile_n;
+        if (best < 0 || perimeter < best) {
+            best = perimeter;
+            pm = cm;
+            pn = cn;
+        }
+    }
+    if (best < 0) { // Too few register tiles for an exact split: one row or column of tiles
+        pm = std::min(threads, max_pm);
+        pn = std::max(1, std::min(threads / pm, max_pn));
+    }
+
+    int tile_m = round_up((M + pm - 1) / pm, MR);
+    int tile_n = round_up((N + pn - 1) / pn, NR);
+    pool.parallel_for(pm * pn, [&](int t) {
+        int i0 = t / pn * tile_m;
+        int j0 = t % pn * tile_n;
+        if (i0 >= M || j0 >= N) {
+            return;
+        }
+        int mb = std::min(tile_m, M - i0);
+        int nb = std::min(tile_n, N - j0);
+        gemm_packed(A.block(i0, 0, mb, K), pack_b, i0, j0, C.block(i0, j0, mb, nb),
+                    accumulate, blocking, kernel, epilogue);
+    });
+}
+
+template <typename T>
+static void gemm_with_config(MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C,
+                             const GemmConfig& config, bool accumulate, MicroKernel<T> kernel) {
+    if (config.kind == GemmConfig::TILED) {
+        gemm_tiled(A, B, C, config.order, config.tile, config.unroll, accumulate);
+        return;
+    }
+    assert(A.rows == C.rows && B.cols == C.cols && A.cols == B.rows);
+    gemm_parallel(A, ViewPacker<T>{B}, C, accumulate, config.blocking, kernel);
+}
+
+void gemm(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+          const GemmConfig& config, bool accumulate) {
+    gemm_with_config(A, B, C, config, accumulate, select_int_kernel());
+}
+
+void gemm(MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C,
+          const GemmConfig& config, bool accumulate) {
+    gemm_with_config(A, B, C, config, accumulate, micro_kernel<float>);
+}
+
+void gemm(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C, bool accumulate) {
+    GemmConfig config;
+    find_tuned_config<int>(C.rows, C.cols, A.cols, config);
+    gemm(A, B, C, config, accumulate);
+}
+
+void gemm(MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C, bool accumulate) {
+    GemmConfig config;
+    find_tuned_config<float>(C.rows, C.cols, A.cols, config);
+    gemm(A, B, C, config, accumulate);
+}
+
+void gemm(MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C,
+          const GemmEpilogue& epilogue, bool accumulate) {
+    assert(A.rows == C.rows && B.cols == C.cols && A.cols == B.rows);
+    GemmConfig config;
+    find_tuned_config<float>(C.rows, C.cols, A.cols, config);
+    if (config.kind == GemmConfig::TILED) { // Tiled loop nests have no tile store to fuse into
+        gemm_tiled(A, B, C, config.order, config.tile, config.unroll, accumulate);
+        apply_epilogue(epilogue, C, 0, 0, C.rows, C.cols, 0, 0);
+        return;
+    }
+    gemm_parallel(A, ViewPacker<float>{B}, C, accumulate, config.blocking, micro_kernel<float>, &epilogue);
+}
+
+void gemm(int M, int N, int K,
+          const int* A, int lda,
+          const int* B, int ldb,
+          int* C, int ldc,
+          bool accumulate) {
+    gemm(MatrixView<const int>(A, M, K, lda), MatrixView<const int>(B, K, N, ldb),
+         MatrixView<int>(C, M, N, ldc), accumulate);
+}
+
+void gemm(int M, int N, int K,
+          const float* A, int lda,
+          const float* B, int ldb,
+          float* C, int ldc,
+          bool accumulate) {
+    gemm(MatrixView<const float>(A, M, K, lda), MatrixView<const float>(B, K, N, ldb),
+         MatrixView<float>(C, M, N, ldc), accumulate);
+}
+
+void gemm_implicit(MatrixView<const float> A, const GemmRowGather& gather, MatrixView<float> C,
+                   const GemmEpilogue& epilogue, bool accumulate) {
+    GemmConfig config;
+    find_tuned_config<float>(C.rows, C.cols, A.cols, config);
+    GemmBlocking blocking = config.kind == GemmConfig::PACKED ? config.blocking : gemm_default_blocking();
+    gemm_parallel(A, GatherPacker{&gather}, C, accumulate, blocking, micro_kernel<float>, &epilogue);
+}
+
+void gemm_implicit(MatrixView<const float> A, const GemmRowGather& gather, MatrixView<float> C,
+                   bool accumulate) {
+    GemmConfig config;
+    find_tuned_config<float>(C.rows, C.cols, A.cols, config);
+    GemmBlocking blocking = config.kind == GemmConfig::PACKED ? config.blocking : gemm_default_blocking();
+    gemm_parallel(A, GatherPacker{&gather}, C, accumulate, blocking, micro_kernel<float>);
+}
+
+const char* gemm_int_isa() {
+    return int_kernel_name();
+}
@@ -0,0 +1,119 @@
+//
+// Packed, register-blocked GEMM (GotoBLAS / BLIS style).
+//
+
+#pragma once
+
+#include "matrix.h"
+#include <functional>
+
+// Cache blocking of the packed GEMM
+// mc x kc block of A is packed to live in L2, kc x nc panel of B in L3,
+// and every kc x NR micro-panel of B is small enough to stay in L1.
+struct GemmBlocking {
+    int mc;
+    int kc;
+    int nc;
+};
+
+GemmBlocking gemm_default_blocking();
+
+// Loop orders of the cache-tiled variants (matmul_Q3_Tiling.cpp)
+enum class LoopOrder { IJK, IKJ, AT, BT };
+
+const char* loop_order_name(LoopOrder order);
+
+// Kernel choice for one problem shape, as stored in the tuning database (autotune.h)
+struct GemmConfig {
+    enum Kind { PACKED, TILED };
+    Kind kind = PACKED;
+    GemmBlocking blocking = gemm_default_blocking(); // PACKED: cache blocking
+    LoopOrder order = LoopOrder::IKJ;                // TILED: loop order,
+    int tile = 32;                                   //        tile size
+    int unroll = 1;                                  //        and unroll factor (1, 2, 4, 8)
+};
+
+// Activation of a fused epilogue
+enum class Activation { NONE, RELU, RELU6, CLAMP };
+
+inline float activate(float x, Activation activation, float lo, float hi) {
+    switch (activation) {
+        case Activation::RELU: return x > 0.0f ? x : 0.0f;
+        case Activation::RELU6: return x < 0.0f ? 0.0f : (x > 6.0f ? 6.0f : x);
+        case Activation::CLAMP: return x < lo ? lo : (x > hi ? hi : x);
+        default: return x;
+    }
+}
+
+// Epilogue fused into the store of each output tile: C = act(A * B + bias + residual).
+// It is applied once per tile, right after the last k slice, while the tile is still in L1.
+struct GemmEpilogue {
+    const float* bias = nullptr;        // bias[i] per row of C, or bias[j] per column
+    bool bias_per_row = true;
+    MatrixView<const float> residual;   // Same shape as C; ignored when data is null
+    Activation activation = Activation::NONE;
+    float clamp_min = 0.0f;             // CLAMP bounds
+    float clamp_max = 6.0f;
+
+    float apply(float x, int i, int j) const {
+        if (bias) {
+            x += bias[bias_per_row ? i : j];
+        }
+        if (residual.data) {
+            x += residual(i, j);
+        }
+        return activate(x, activation, clamp_min, clamp_max);
+    }
+};
+
+// C = A * B (or C += A * B when accumulate is set) for any M x K times K x N.
+// The views may carry arbitrary row / col strides (sub-blocks, transposes).
+// Large problems are split into 2D macro-tiles of C and run on the global
+// thread pool; see set_num_threads() in thread_pool.h. If the tuning
+// database holds an entry for this shape, that configuration is used.
+void gemm(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C, bool accumulate = false);
+void gemm(MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C, bool accumulate = false);
+
+// Same, with an explicit configuration instead of the tuning database
+void gemm(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+          const GemmConfig& config, bool accumulate = false);
+void gemm(MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C,
+          const GemmConfig& config, bool accumulate = false);
+
+// C = epilogue(A * B)
+void gemm(MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C,
+          const GemmEpilogue& epilogue, bool accumulate = false);
+
+// Single-threaded cache-tiled loop nest: size x size x size tiles, innermost loop unrolled by `unroll`
+void gemm_tiled(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+                LoopOrder order, int size, int unroll, bool accumulate = false);
+void gemm_tiled(MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C,
+                LoopOrder order, int size, int unroll, bool accumulate = false);
+
+// Same as above on raw row-major buffers: C[M][N] = A[M][K] * B[K][N].
+// lda / ldb / ldc are the row strides (in elements) of the operands.
+void gemm(int M, int N, int K,
+          const int* A, int lda,
+          const int* B, int ldb,
+          int* C, int ldc,
+          bool accumulate = false);
+
+void gemm(int M, int N, int K,
+          const float* A, int lda,
+          const float* B, int ldb,
+          float* C, int ldc,
+          bool accumulate = false);
+
+// Row segment B(k, j0 .. j0 + count - 1) of an implicit B operand, written to dst
+using GemmRowGather = std::function<void(int k, int j0, int count, float* dst)>;
+
+// C = A * B where B (A.cols x C.cols) is never stored: the packing stage asks
+// `gather` for every NR-wide row segment while filling its micro-panels.
+// Used by the implicit-GEMM convolution, whose B is the virtual im2col matrix.
+void gemm_implicit(MatrixView<const float> A, const GemmRowGather& gather, MatrixView<float> C,
+                   bool accumulate = false);
+void gemm_implicit(MatrixView<const float> A, const GemmRowGather& gather, MatrixView<float> C,
+                   const GemmEpilogue& epilogue, bool accumulate = false);
+
+// Name of the int32 micro-kernel picked for this host ("avx512", "avx2", "sse4.1" or "scalar")
+const char* gemm_int_isa();
@@ -0,0 +1,16 @@
+//
+// Micro-kernels shared by the packed GEMM and its runtime ISA dispatch.
+//
+
+#pragma once
+
+constexpr int MR = 4;  // rows of the register tile
+constexpr int NR = 16; // cols of the register tile
+
+// C[MR][NR] = a * b (or C += a * b) over kc steps of packed A (MR wide) and packed B (NR wide)
+template <typename T>
+using MicroKernel = void (*)(int kc, const T* a, const T* b, T* C, int ldc, bool accumulate);
+
+// Best int32 micro-kernel for the host CPU (AVX-512 / AVX2 / SSE4.1 / scalar), picked once via CPUID
+MicroKernel<int> select_int_kernel();
+const char* int_kernel_name();
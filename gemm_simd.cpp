@@ -0,0 +1,156 @@
+//
+// Hand-written int32 micro-kernels, selected at startup via CPUID.
+//
+// Each kernel is compiled for its own ISA with a target attribute, so the
+// binary itself stays at the baseline ISA and runs on any x86-64 host.
+//
+
+#include "gemm_kernels.h"
+#include <immintrin.h>
+
+// Portable fallback: the tile is swept in two 8-wide halves so the
+// accumulators fit the 16 baseline SSE registers.
+static void kernel_int_scalar(int kc, const int* a, const int* b, int* C, int ldc, bool accumulate) {
+    constexpr int NR_HALF = NR / 2;
+    for (int h = 0; h < NR; h += NR_HALF) {
+        int acc[MR][NR_HALF] = {};
+        const int* pa = a;
+        const int* pb = b + h;
+        for (int k = 0; k < kc; ++k) {
+            for (int r = 0; r < MR; ++r) {
+                int ar = pa[r];
+                for (int c = 0; c < NR_HALF; ++c) {
+                    acc[r][c] += ar * pb[c];
+                }
+            }
+            pa += MR;
+            pb += NR;
+        }
+        for (int r = 0; r < MR; ++r) {
+            for (int c = 0; c < NR_HALF; ++c) {
+                int* out = C + r * ldc + h + c;
+                *out = accumulate ? *out + acc[r][c] : acc[r][c];
+            }
+        }
+    }
+}
+
+// SSE4.1: pmulld on 4 lanes, two 8-wide halves of 4x2 xmm accumulators
+__attribute__((target("sse4.1")))
+static void kernel_int_sse41(int kc, const int* a, const int* b, int* C, int ldc, bool accumulate) {
+    for (int h = 0; h < NR; h += 8) {
+        __m128i acc[MR][2];
+        for (int r = 0; r < MR; ++r) {
+            acc[r][0] = _mm_setzero_si128();
+            acc[r][1] = _mm_setzero_si128();
+        }
+        const int* pa = a;
+        const int* pb = b + h;
+        for (int k = 0; k < kc; ++k) {
+            __m128i b0 = _mm_load_si128(reinterpret_cast<const __m128i*>(pb));
+            __m128i b1 = _mm_load_si128(reinterpret_cast<const __m128i*>(pb + 4));
+            for (int r = 0; r < MR; ++r) {
+                __m128i ar = _mm_set1_epi32(pa[r]);
+                acc[r][0] = _mm_add_epi32(acc[r][0], _mm_mullo_epi32(ar, b0));
+                acc[r][1] = _mm_add_epi32(acc[r][1], _mm_mullo_epi32(ar, b1));
+            }
+            pa += MR;
+            pb += NR;
+        }
+        for (int r = 0; r < MR; ++r) {
+            __m128i* out = reinterpret_cast<__m128i*>(C + r * ldc + h);
+            if (accumulate) {
+                acc[r][0] = _mm_add_epi32(acc[r][0], _mm_loadu_si128(out));
+                acc[r][1] = _mm_add_epi32(acc[r][1], _mm_loadu_si128(out + 1));
+            }
+            _mm_storeu_si128(out, acc[r][0]);
+            _mm_storeu_si128(out + 1, acc[r][1]);
+        }
+    }
+}
+
+// AVX2: vpmulld on 8 lanes, 4x2 ymm accumulators cover the whole tile
+__attribute__((target("avx2")))
+static void kernel_int_avx2(int kc, const int* a, const int* b, int* C, int ldc, bool accumulate) {
+    __m256i acc[MR][2];
+    for (int r = 0; r < MR; ++r) {
+        acc[r][0] = _mm256_setzero_si256();
+        acc[r][1] = _mm256_setzero_si256();
+    }
+    for (int k = 0; k < kc; ++k) {
+        __m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b));
+        __m256i b1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + 8));
+        for (int r = 0; r < MR; ++r) {
+            __m256i ar = _mm256_set1_epi32(a[r]);
+            acc[r][0] = _mm256_add_epi32(acc[r][0], _mm256_mullo_epi32(ar, b0));
+            acc[r][1] = _mm256_add_epi32(acc[r][1], _mm256_mullo_epi32(ar, b1));
+        }
+        a += MR;
+        b += NR;
+    }
+    for (int r = 0; r < MR; ++r) {
+        __m256i* out = reinterpret_cast<__m256i*>(C + r * ldc);
+        if (accumulate) {
+            acc[r][0] = _mm256_add_epi32(acc[r][0], _mm256_loadu_si256(out));
+            acc[r][1] = _mm256_add_epi32(acc[r][1], _mm256_loadu_si256(out + 1));
+        }
+        _mm256_storeu_si256(out, acc[r][0]);
+        _mm256_storeu_si256(out + 1, acc[r][1]);
+    }
+}
+
+// AVX-512: one zmm per tile row
+__attribute__((target("avx512f")))
+static void kernel_int_avx512(int kc, const int* a, const int* b, int* C, int ldc, bool accumulate) {
+    __m512i acc[MR];
+    for (int r = 0; r < MR; ++r) {
+        acc[r] = _mm512_setzero_si512();
+    }
+    for (int k = 0; k < kc; ++k) {
+        __m512i b0 = _mm512_load_si512(b);
+        for (int r = 0; r < MR; ++r) {
+            acc[r] = _mm512_add_epi32(acc[r], _mm512_mullo_epi32(_mm512_set1_epi32(a[r]), b0));
+        }
+        a += MR;
+        b += NR;
+    }
+    for (int r = 0; r < MR; ++r) {
+        int* out = C + r * ldc;
+        if (accumulate) {
+            acc[r] = _mm512_add_epi32(acc[r], _mm512_loadu_si512(out));
+        }
+        _mm512_storeu_si512(out, acc[r]);
+    }
+}
+
+struct IntKernelChoice {
+    MicroKernel<int> kernel;
+    const char* name;
+};
+
+static IntKernelChoice detect_int_kernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return {kernel_int_avx512, "avx512"};
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return {kernel_int_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return {kernel_int_sse41, "sse4.1"};
+    }
+    return {kernel_int_scalar, "scalar"};
+}
+
+static const IntKernelChoice& int_kernel_choice() {
+    static const IntKernelChoice choice = detect_int_kernel(); // CPUID is queried once per process
+    return choice;
+}
+
+MicroKernel<int> select_int_kernel() {
+    return int_kernel_choice().kernel;
+}
+
+const char* int_kernel_name() {
+    return int_kernel_choice().name;
+}
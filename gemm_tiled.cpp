@@ -0,0 +1,150 @@
+//
+// Cache-tiled GEMM loop nests (the ijk / ikj / AT / BT variants of
+// matmul_Q3_Tiling.cpp) on matrix views, with a tunable tile size and
+// unroll factor of the innermost loop.
+//
+
+#include "gemm.h"
+#include <algorithm>
+#include <cassert>
+
+// Innermost loop is a dot product over k: U independent partial sums
+template <typename T, int U>
+static T dot(const T* a, std::ptrdiff_t a_step, const T* b, std::ptrdiff_t b_step, int count) {
+    T partial[U] = {};
+    int p = 0;
+    for (; p + U <= count; p += U) {
+        for (int u = 0; u < U; ++u) {
+            partial[u] += a[(p + u) * a_step] * b[(p + u) * b_step];
+        }
+    }
+    T sum = 0;
+    for (; p < count; ++p) {
+        sum += a[p * a_step] * b[p * b_step];
+    }
+    for (int u = 0; u < U; ++u) {
+        sum += partial[u];
+    }
+    return sum;
+}
+
+// Innermost loop is an axpy over j: c[j] += a * b[j], U elements per step
+template <typename T, int U>
+static void axpy(T a, const T* b, std::ptrdiff_t b_step, T* c, std::ptrdiff_t c_step, int count) {
+    int j = 0;
+    for (; j + U <= count; j += U) {
+        for (int u = 0; u < U; ++u) {
+            c[(j + u) * c_step] += a * b[(j + u) * b_step];
+        }
+    }
+    for (; j < count; ++j) {
+        c[j * c_step] += a * b[j * b_step];
+    }
+}
+
+// i, j, k tiles; inside a tile either m-n-p (dot over k) or m-p-n (axpy over j).
+// A and B may be transposed copies, which is how the AT / BT variants are run.
+template <typename T, int U>
+static void tiled_loops(MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C,
+                        bool k_innermost, int size) {
+    int M = C.rows;
+    int N = C.cols;
+    int K = A.cols;
+    for (int i = 0; i < M; i += size) {
+        for (int j = 0; j < N; j += size) {
+            for (int k = 0; k < K; k += size) {
+                int maxM = std::min(i + size, M);
+                int maxN = std::min(j + size, N);
+                int maxP = std::min(k + size, K);
+                if (k_innermost) {
+                    for (int m = i; m < maxM; ++m) {
+                        for (int n = j; n < maxN; ++n) {
+                            C(m, n) += dot<T, U>(&A(m, k), A.col_stride, &B(k, n), B.row_stride, maxP - k);
+                        }
+                    }
+                } else {
+                    for (int m = i; m < maxM; ++m) {
+                        for (int p = k; p < maxP; ++p) {
+                            axpy<T, U>(A(m, p), &B(p, j), B.col_stride, &C(m, j), C.col_stride, maxN - j);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+static void tiled_dispatch(MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C,
+                           bool k_innermost, int size, int unroll) {
+    switch (unroll) {
+        case 1: tiled_loops<T, 1>(A, B, C, k_innermost, size); break;
+        case 2: tiled_loops<T, 2>(A, B, C, k_innermost, size); break;
+        case 4: tiled_loops<T, 4>(A, B, C, k_innermost, size); break;
+        default: tiled_loops<T, 8>(A, B, C, k_innermost, size); break;
+    }
+}
+
+template <typename T>
+static void gemm_tiled_impl(MatrixView<const T> A, MatrixView<const T> B, MatrixView<T> C,
+                            LoopOrder order, int size, int unroll, bool accumulate) {
+    assert(A.rows == C.rows && B.cols == C.cols && A.cols == B.rows);
+    size = std::max(1, size);
+    if (!accumulate) {
+        for (int i = 0; i < C.rows; ++i) {
+            for (int j = 0; j < C.cols; ++j) {
+                C(i, j) = 0;
+            }
+        }
+    }
+    switch (order) {
+        case LoopOrder::IJK:
+            tiled_dispatch(A, B, C, true, size, unroll);
+            break;
+        case LoopOrder::IKJ:
+            tiled_dispatch(A, B, C, false, size, unroll);
+            break;
+        case LoopOrder::AT: { // Column of A made contiguous: AT[k][i] = A[i][k]
+            Matrix<T> AT(A.cols, A.rows);
+            for (int i = 0; i < A.cols; ++i) {
+                for (int j = 0; j < A.rows; ++j) {
+                    AT(i, j) = A(j, i);
+                }
+            }
+            MatrixView<const T> at = AT.view();
+            tiled_dispatch(at.transposed(), B, C, true, size, unroll);
+            break;
+        }
+        case LoopOrder::BT: { // Column of B made contiguous: BT[j][k] = B[k][j]
+            Matrix<T> BT(B.cols, B.rows);
+            for (int i = 0; i < B.cols; ++i) {
+                for (int j = 0; j < B.rows; ++j) {
+                    BT(i, j) = B(j, i);
+                }
+            }
+            MatrixView<const T> bt = BT.view();
+            tiled_dispatch(A, bt.transposed(), C, true, size, unroll);
+            break;
+        }
+    }
+}
+
+void gemm_tiled(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+                LoopOrder order, int size, int unroll, bool accumulate) {
+    gemm_tiled_impl(A, B, C, order, size, unroll, accumulate);
+}
+
+void gemm_tiled(MatrixView<const float> A, MatrixView<const float> B, MatrixView<float> C,
+                LoopOrder order, int size, int unroll, bool accumulate) {
+    gemm_tiled_impl(A, B, C, order, size, unroll, accumulate);
+}
+
+const char* loop_order_name(LoopOrder order) {
+    switch (order) {
+        case LoopOrder::IJK: return "ijk";
+        case LoopOrder::IKJ: return "ikj";
+        case LoopOrder::AT: return "AT";
+        case LoopOrder::BT: return "BT";
+    }
+    return "?";
+}
@@ -3,154 +3,550 @@
 //
 #include <iostream>
 #include <vector>
-#include <unordered_map>
+#include <cstdint>
 #include <tuple>
-#include "cnpy/cnpy.h" // 用于加载 .npy 文件
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <immintrin.h>
+#include "npy.h" // 用于加载 / 写出 .npy 文件 (mmap, 零拷贝)
+#include "gemm.h"
+#include "matrix.h"
+#include "thread_pool.h"
 
 using namespace std;
 
-// 定义稀疏点结构
-struct SparsePoint {
+// 稀疏点坐标
+struct Coordinate {
     int batch; // 批次索引 (batch)
-    int x;     // 高度位置 (row)
-    int y;     // 宽度位置 (column)
-    vector<float> features; // 输入通道的特征值
+    int x;     // 体素坐标, 对应数组第 0 维
+    int y;     // 第 1 维
+    int z;     // 第 2 维
+};
+
+// 稀疏张量 (SoA): 坐标数组 + 一块连续的 N x C 特征矩阵,
+// 第 i 行是第 i 个点的特征, 每行按 64 字节对齐 (见 matrix.h)
+struct SparseTensor {
+    vector<Coordinate> coords;
+    Matrix<float> features;
+
+    int size() const { return static_cast<int>(coords.size()); }
+    int channels() const { return features.cols(); }
+};
+
+// 三维卷积核偏移
+struct Offset {
+    int dx, dy, dz;
 };
 
 // 定义卷积核的结构
 struct Kernel {
-    int kernel_size; // 卷积核大小 (例如 3 表示 3x3)
-    vector<pair<int, int>> offsets; // 卷积核的偏移
+    int kernel_size; // 卷积核大小 (例如 3 表示 3x3x3)
+    vector<Offset> offsets; // 卷积核的偏移 (kernel_size^3 个)
+};
+
+// 三维网格大小
+struct GridShape {
+    int x, y, z;
 };
 
-// 创建卷积核的偏移
+// 创建卷积核的偏移 (3x3x3 共 27 个)
 Kernel createKernel(int kernel_size) {
     Kernel kernel;
     kernel.kernel_size = kernel_size;
-    int radius = kernel_size / 2; // 半径 (3x3的半径是1)
+    int radius = kernel_size / 2; // 半径 (3x3x3的半径是1)
     for (int dx = -radius; dx <= radius; ++dx) {
         for (int dy = -radius; dy <= radius; ++dy) {
-            kernel.offsets.emplace_back(dx, dy);
+            for (int dz = -radius; dz <= radius; ++dz) {
+                kernel.offsets.push_back({dx, dy, dz});
+            }
         }
     }
     return kernel;
 }
 
-// Rulebook 的创建
-unordered_map<int, vector<pair<int, int>>> createRulebook(
-    const vector<SparsePoint>& inputPoints,
+// 坐标打包为 64 位键: batch / x / y / z 各占 16 位 (加偏移后允许负坐标)
+inline uint64_t packCoordinate(int batch, int x, int y, int z = 0) {
+    const int bias = 1 << 15;
+    return (static_cast<uint64_t>(batch & 0xffff) << 48) |
+           (static_cast<uint64_t>((x + bias) & 0xffff) << 32) |
+           (static_cast<uint64_t>((y + bias) & 0xffff) << 16) |
+           static_cast<uint64_t>((z + bias) & 0xffff);
+}
+
+// 开放寻址坐标哈希表 (线性探测, 容量为 2 的幂, 键为打包坐标, 值为点的下标)
+// 所有键值存放在两个连续数组中, 没有逐节点的堆分配
+class CoordinateMap {
+public:
+    explicit CoordinateMap(size_t expected = 16) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) { // 装载因子不超过 0.5
+            capacity *= 2;
+        }
+        keys.assign(capacity, EMPTY);
+        values.assign(capacity, -1);
+        mask = capacity - 1;
+    }
+
+    // 查找坐标, 不存在时返回 -1
+    int find(uint64_t key) const {
+        for (size_t slot = hash(key) & mask; ; slot = (slot + 1) & mask) {
+            if (keys[slot] == key) return values[slot];
+            if (keys[slot] == EMPTY) return -1;
+        }
+    }
+
+    // 插入坐标; 若已存在则返回原有的值, 否则写入 value 并返回它
+    int insert(uint64_t key, int value) {
+        if ((count + 1) * 2 > keys.size()) {
+            grow();
+        }
+        size_t slot = hash(key) & mask;
+        while (keys[slot] != EMPTY) {
+            if (keys[slot] == key) return values[slot];
+            slot = (slot + 1) & mask;
+        }
+        keys[slot] = key;
+        values[slot] = value;
+        ++count;
+        return value;
+    }
+
+    size_t size() const { return count; }
+
+private:
+    static constexpr uint64_t EMPTY = ~0ull;
+
+    // splitmix64 终结函数, 打散相邻坐标
+    static uint64_t hash(uint64_t key) {
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ull;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebull;
+        key ^= key >> 31;
+        return key;
+    }
+
+    void grow() {
+        vector<uint64_t> old_keys;
+        vector<int> old_values;
+        old_keys.swap(keys);
+        old_values.swap(values);
+        keys.assign(old_keys.size() * 2, EMPTY);
+        values.assign(old_keys.size() * 2, -1);
+        mask = keys.size() - 1;
+        count = 0;
+        for (size_t i = 0; i < old_keys.size(); ++i) {
+            if (old_keys[i] != EMPTY) insert(old_keys[i], old_values[i]);
+        }
+    }
+
+    vector<uint64_t> keys;
+    vector<int> values;
+    size_t mask = 0;
+    size_t count = 0;
+};
+
+// 稀疏卷积模式
+enum class SparseConvMode {
+    SUBMANIFOLD, // 子流形卷积: 输出点集合 = 输入点集合, 多层之后活跃点不会膨胀
+    REGULAR      // 常规 (可带步长) 稀疏卷积: 任何被卷积核覆盖到的位置都成为输出点
+};
+
+// Rulebook: 每个卷积核偏移一组连续的 (输入下标, 输出下标) 对 (SpConv / MinkowskiEngine 的布局)
+// 两种模式都满足: 输入坐标 = 输出坐标 * stride + 偏移
+struct Rulebook {
+    vector<vector<pair<int, int>>> rules; // rules[k]: 第 k 个偏移上的所有映射
+    vector<Coordinate> outputSites;       // 输出点坐标, 下标即输出下标
+    GridShape shape = {0, 0, 0};          // 输出网格大小
+};
+
+// 子流形 Rulebook: 输出点就是输入点, 只对输入坐标表做查找, 不插入新坐标
+Rulebook createSubmanifoldRulebook(
+    const vector<Coordinate>& inputPoints,
     const Kernel& kernel,
-    int height,
-    int width
+    GridShape shape
 ) {
-    unordered_map<int, vector<pair<int, int>>> rulebook;
+    Rulebook rulebook;
+    rulebook.rules.resize(kernel.offsets.size());
+    rulebook.shape = shape;
+    rulebook.outputSites.reserve(inputPoints.size());
 
+    CoordinateMap inputMap(inputPoints.size());
     for (size_t i = 0; i < inputPoints.size(); ++i) {
         const auto& point = inputPoints[i];
-        for (const auto& offset : kernel.offsets) {
-            int nx = point.x + offset.first;
-            int ny = point.y + offset.second;
-
-            // 确保邻域坐标在矩阵范围内
-            if (nx >= 0 && nx < height && ny >= 0 && ny < width) {
-                // 计算输出点的哈希值作为键
-                int hashKey = nx * width + ny;
-                rulebook[hashKey].emplace_back(i, hashKey);
+        inputMap.insert(packCoordinate(point.batch, point.x, point.y, point.z), static_cast<int>(i));
+        rulebook.outputSites.push_back(point);
+    }
+
+    for (size_t k = 0; k < kernel.offsets.size(); ++k) {
+        const auto& offset = kernel.offsets[k];
+        auto& rules = rulebook.rules[k];
+        rules.reserve(inputPoints.size());
+        for (size_t i = 0; i < inputPoints.size(); ++i) {
+            const auto& point = inputPoints[i];
+            int j = inputMap.find(packCoordinate(point.batch, point.x + offset.dx, point.y + offset.dy, point.z + offset.dz));
+            if (j >= 0) { // 邻居也是活跃点
+                rules.emplace_back(j, static_cast<int>(i));
+            }
+        }
+    }
+    return rulebook;
+}
+
+// 常规 / 带步长 Rulebook: 输入点 p 经偏移 d 贡献给输出点 o = (p - d) / stride (需整除),
+// 输出坐标在哈希表中去重并编号
+Rulebook createRulebook(
+    const vector<Coordinate>& inputPoints,
+    const Kernel& kernel,
+    GridShape shape,
+    int stride = 1
+) {
+    Rulebook rulebook;
+    rulebook.rules.resize(kernel.offsets.size());
+    int radius = kernel.kernel_size / 2;
+    auto outputSize = [&](int size) { // 与 padding = radius 的稠密卷积一致
+        return (size + 2 * radius - kernel.kernel_size) / stride + 1;
+    };
+    rulebook.shape = {outputSize(shape.x), outputSize(shape.y), outputSize(shape.z)};
+    CoordinateMap outputMap(inputPoints.size() * 2);
+
+    for (size_t k = 0; k < kernel.offsets.size(); ++k) {
+        const auto& offset = kernel.offsets[k];
+        auto& rules = rulebook.rules[k];
+        rules.reserve(inputPoints.size());
+        for (size_t i = 0; i < inputPoints.size(); ++i) {
+            const auto& point = inputPoints[i];
+            int px = point.x - offset.dx;
+            int py = point.y - offset.dy;
+            int pz = point.z - offset.dz;
+            if (px < 0 || py < 0 || pz < 0 || px % stride != 0 || py % stride != 0 || pz % stride != 0) continue;
+            int nx = px / stride;
+            int ny = py / stride;
+            int nz = pz / stride;
+
+            // 确保输出坐标在输出网格范围内
+            if (nx < rulebook.shape.x && ny < rulebook.shape.y && nz < rulebook.shape.z) {
+                int next = static_cast<int>(rulebook.outputSites.size());
+                int out = outputMap.insert(packCoordinate(point.batch, nx, ny, nz), next);
+                if (out == next) {
+                    rulebook.outputSites.push_back({point.batch, nx, ny, nz});
+                }
+                rules.emplace_back(static_cast<int>(i), out);
             }
         }
     }
     return rulebook;
 }
 
-// Submanifold Sparse Convolution 操作
-vector<SparsePoint> submSparseConv(
-    const vector<SparsePoint>& inputPoints,
+// Sparse Convolution 操作 (子流形与常规模式共用, 区别只在 Rulebook)
+// 对每个卷积核偏移 k: 收集 (gather) 匹配的输入特征行为连续矩阵 (n_k x in),
+// 与该偏移的权重 W_k (in x out) 做稠密 GEMM, 再按输出下标累加 (scatter-add)
+SparseTensor sparseConv(
+    const SparseTensor& input,
     const Kernel& kernel,
-    const unordered_map<int, vector<pair<int, int>>>& rulebook,
-    const vector<vector<float>>& weights, // 卷积权重 (in_channels x out_channels)
+    const Rulebook& rulebook,
+    const vector<float>& weights, // 卷积权重 (offsets x in_channels x out_channels)
     int out_channels
 ) {
-    vector<SparsePoint> outputPoints;
+    int in_channels = input.channels();
+    SparseTensor output;
+    output.coords = rulebook.outputSites;
+    output.features = Matrix<float>(output.size(), out_channels); // 输出特征 (初始化为0)
+    Matrix<float> gathered, product;
 
-    // 遍历 Rulebook，执行卷积操作
-    for (const auto& rule : rulebook) {
-        int outputHashKey = rule.first; // 输出点的哈希值
-        const auto& mappings = rule.second;
+    for (size_t k = 0; k < kernel.offsets.size(); ++k) {
+        const auto& rules = rulebook.rules[k];
+        int n = static_cast<int>(rules.size());
+        if (n == 0) continue;
+        if (n > gathered.rows()) { // 按最大的偏移分配一次
+            gathered = Matrix<float>(n, in_channels);
+            product = Matrix<float>(n, out_channels);
+        }
 
-        vector<float> newFeatures(out_channels, 0.0f); // 输出点的特征值 (初始化为0)
+        // Gather: 输入特征行 -> n x in_channels
+        for (int r = 0; r < n; ++r) {
+            const float* row = &input.features(rules[r].first, 0);
+            copy(row, row + in_channels, &gathered(r, 0));
+        }
 
-        for (const auto& mapping : mappings) {
-            int inputIndex = mapping.first; // 输入点索引
-            const auto& inputFeatures = inputPoints[inputIndex].features;
+        // GEMM: (n x in) * W_k (in x out)
+        MatrixView<float> result = product.view().block(0, 0, n, out_channels);
+        MatrixView<const float> W_k(weights.data() + k * in_channels * out_channels, in_channels, out_channels, out_channels);
+        gemm(gathered.view().block(0, 0, n, in_channels), W_k, result);
 
-            // 计算卷积操作 (输入特征 x 权重)
-            for (size_t in_ch = 0; in_ch < inputFeatures.size(); ++in_ch) {
-                for (int out_ch = 0; out_ch < out_channels; ++out_ch) {
-                    newFeatures[out_ch] += inputFeatures[in_ch] * weights[in_ch][out_ch];
-                }
+        // Scatter-add: 累加到对应的输出行
+        for (int r = 0; r < n; ++r) {
+            float* out = &output.features(rules[r].second, 0);
+            const float* row = &result(r, 0);
+            for (int out_ch = 0; out_ch < out_channels; ++out_ch) {
+                out[out_ch] += row[out_ch];
             }
         }
+    }
+    return output;
+}
 
-        // 还原输出点的坐标
-        int x = outputHashKey / kernel.offsets.size();
-        int y = outputHashKey % kernel.offsets.size();
+// 稠密 -> 稀疏提取核: 找出 data[0, count) 中的非零元素, 依次写出其位置 (相对 data) 与
+// float32 值, 返回非零个数. positions / values 需预留 count + EXTRACT_SLACK 个元素
+// (向量化版本按整向量写出, 再只前移有效个数)
+constexpr size_t EXTRACT_SLACK = 16;
+typedef size_t (*ExtractKernel)(const double* data, size_t count, uint32_t* positions, float* values);
 
-        // 添加到输出点
-        outputPoints.push_back({0, x, y, newFeatures});
+static size_t extractScalar(const double* data, size_t count, uint32_t* positions, float* values) {
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (data[i] != 0.0) {
+            positions[n] = static_cast<uint32_t>(i);
+            values[n] = static_cast<float>(data[i]);
+            ++n;
+        }
     }
+    return n;
+}
 
-    return outputPoints;
+// AVX2: 4 个 double 比较 + movemask, 按掩码位逐个写出 (AVX2 没有 compress 指令)
+__attribute__((target("avx2")))
+static size_t extractAvx2(const double* data, size_t count, uint32_t* positions, float* values) {
+    size_t n = 0;
+    size_t i = 0;
+    __m256d zero = _mm256_setzero_pd();
+    for (; i + 4 <= count; i += 4) {
+        __m256d v = _mm256_loadu_pd(data + i);
+        unsigned mask = _mm256_movemask_pd(_mm256_cmp_pd(v, zero, _CMP_NEQ_UQ));
+        if (mask == 0) continue; // 绝大多数体素为零, 整组跳过
+        alignas(16) float converted[4];
+        _mm_store_ps(converted, _mm256_cvtpd_ps(v));
+        while (mask) {
+            unsigned lane = __builtin_ctz(mask);
+            positions[n] = static_cast<uint32_t>(i + lane);
+            values[n] = converted[lane];
+            ++n;
+            mask &= mask - 1;
+        }
+    }
+    size_t tail = extractScalar(data + i, count - i, positions + n, values + n);
+    for (size_t r = n; r < n + tail; ++r) positions[r] += static_cast<uint32_t>(i);
+    return n + tail;
 }
 
-// 从 .npy 文件中加载稀疏矩阵
-vector<SparsePoint> loadSparseMatrix(const string& filePath, int height, int width, int in_channels) {
-    // 加载 .npy 文件
-    cnpy::NpyArray arr = cnpy::npy_load(filePath);
-    double* data = arr.data<double>();
+// AVX-512: 8 个 double 比较得到掩码, compress 把非零的值与下标压紧后整向量写出
+__attribute__((target("avx512f")))
+static size_t extractAvx512(const double* data, size_t count, uint32_t* positions, float* values) {
+    size_t n = 0;
+    size_t i = 0;
+    __m512d zero = _mm512_setzero_pd();
+    __m512i lanes = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    for (; i + 8 <= count; i += 8) {
+        __m512d v = _mm512_loadu_pd(data + i);
+        __mmask8 mask = _mm512_cmp_pd_mask(v, zero, _CMP_NEQ_UQ);
+        if (mask == 0) continue;
+        __m256 packed = _mm512_mask_cvtpd_ps(_mm256_setzero_ps(), 0xff, _mm512_maskz_compress_pd(mask, v));
+        __m512i index = _mm512_add_epi32(lanes, _mm512_set1_epi32(static_cast<int>(i)));
+        _mm256_storeu_ps(values + n, packed);
+        _mm512_mask_compressstoreu_epi32(positions + n, mask, index);
+        n += __builtin_popcount(mask);
+    }
+    size_t tail = extractScalar(data + i, count - i, positions + n, values + n);
+    for (size_t r = n; r < n + tail; ++r) positions[r] += static_cast<uint32_t>(i);
+    return n + tail;
+}
 
-    vector<SparsePoint> sparsePoints;
+// 按 CPUID 选择一次
+static ExtractKernel selectExtractKernel() {
+    static const ExtractKernel kernel = []() -> ExtractKernel {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return extractAvx512;
+        if (__builtin_cpu_supports("avx2")) return extractAvx2;
+        return extractScalar;
+    }();
+    return kernel;
+}
 
-    // 遍历矩阵，提取非零值
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            double value = data[i * width + j];
-            if (value != 0.0) { // 如果矩阵的值非零，则保存为稀疏点
-                SparsePoint point;
-                point.batch = 0; // 假设 batch = 1
-                point.x = i;
-                point.y = j;
-                point.features.push_back(static_cast<float>(value)); // 单通道输入
-                sparsePoints.push_back(point);
-            }
+constexpr size_t EXTRACT_SLAB = 1 << 16; // 并行粒度: 每个 slab 64K 个体素
+
+// 一个 slab 提取出的点, 按存储顺序
+struct SlabHits {
+    vector<Coordinate> coords;
+    vector<float> values;
+};
+
+// 单遍提取: 各 slab 并行扫描一次稠密数据, 把非零点 (已还原的坐标与值) 写进自己的 SlabHits.
+// 提取核按整向量写出, 会越过有效个数, 所以先写线程私有的暂存区, 再按实际个数拷入 SlabHits.
+// first 为 data[0] 在整个数组中的存储位置
+static vector<SlabHits> extractNonzeros(const double* data, size_t count, size_t first, const NpyHeader& header) {
+    vector<SlabHits> slabs((count + EXTRACT_SLAB - 1) / EXTRACT_SLAB);
+    ExtractKernel kernel = selectExtractKernel();
+    global_thread_pool().parallel_for(static_cast<int>(slabs.size()), [&](int s) {
+        size_t begin = s * EXTRACT_SLAB;
+        thread_local vector<uint32_t> positions(EXTRACT_SLAB + EXTRACT_SLACK);
+        thread_local vector<float> found(EXTRACT_SLAB + EXTRACT_SLACK);
+        size_t n = kernel(data + begin, min(EXTRACT_SLAB, count - begin), positions.data(), found.data());
+        SlabHits& hits = slabs[s];
+        hits.coords.resize(n);
+        hits.values.assign(found.begin(), found.begin() + n);
+        for (size_t r = 0; r < n; ++r) {
+            size_t index[3] = {0, 0, 0}; // 由存储位置还原三维坐标 (gridShape 保证 ndim <= 3)
+            header.unravel(first + begin + positions[r], index);
+            hits.coords[r] = {0, static_cast<int>(index[0]), static_cast<int>(index[1]), static_cast<int>(index[2])};
+        }
+    });
+    return slabs;
+}
+
+// 各 slab 点数的互斥前缀和 (slabs + 1 项, 最后一项为总数)
+static vector<size_t> hitOffsets(const vector<SlabHits>& slabs) {
+    vector<size_t> offsets(slabs.size() + 1, 0);
+    for (size_t s = 0; s < slabs.size(); ++s) offsets[s + 1] = offsets[s] + slabs[s].coords.size();
+    return offsets;
+}
+
+// 按 offsets 把各 slab 的点并行拷到最终位置 coords[offsets[s]..] 与
+// values[offsets[s] * valueStride ..] (特征矩阵的一列)
+static void copyHits(const vector<SlabHits>& slabs, const vector<size_t>& offsets,
+                     Coordinate* coords, float* values, size_t valueStride) {
+    global_thread_pool().parallel_for(static_cast<int>(slabs.size()), [&](int s) {
+        const SlabHits& hits = slabs[s];
+        copy(hits.coords.begin(), hits.coords.end(), coords + offsets[s]);
+        for (size_t r = 0; r < hits.values.size(); ++r) {
+            values[(offsets[s] + r) * valueStride] = hits.values[r];
         }
+    });
+}
+
+// 体素网格形状: 最多三维, 缺少的维度按 1 计. 更高维的数组没有对应的 (x, y, z),
+// 且 unravel() 会写出 ndim 个下标, 因此直接拒绝
+static GridShape gridShape(const NpyHeader& header) {
+    if (header.shape.size() > 3) {
+        throw runtime_error("npy: expected at most 3 dimensions, got " + to_string(header.shape.size()));
+    }
+    size_t dims[3] = {1, 1, 1};
+    for (size_t d = 0; d < header.shape.size(); ++d) dims[d] = header.shape[d];
+    return {static_cast<int>(dims[0]), static_cast<int>(dims[1]), static_cast<int>(dims[2])};
+}
+
+// 单通道特征矩阵
+static Matrix<float> featureColumn(const vector<float>& values) {
+    Matrix<float> features(static_cast<int>(values.size()), 1);
+    for (size_t i = 0; i < values.size(); ++i) {
+        features(static_cast<int>(i), 0) = values[i];
+    }
+    return features;
+}
+
+// 从 .npy 文件中加载三维稀疏体素
+// pointcloud.npy 是 (64, 64, 64) 的 float64 数组且 fortran_order = True;
+// 文件被 mmap 后直接在映射上提取, 坐标由文件头 (C / Fortran 顺序) 还原, 不复制稠密数据.
+// 点按文件存储顺序排列
+SparseTensor loadSparseVolume(const string& filePath, GridShape& shape) {
+    // 映射 .npy 文件
+    NpyFile file(filePath);
+    shape = gridShape(file.header());
+    NpyView<double> data = file.view<double>();
+
+    // 单遍提取到各 slab, 再由前缀和定位, 拷进最终的坐标数组与特征矩阵
+    SparseTensor tensor;
+    vector<SlabHits> slabs = extractNonzeros(data.data, file.header().count(), 0, file.header());
+    vector<size_t> offsets = hitOffsets(slabs);
+    tensor.coords.resize(offsets.back());
+    tensor.features = Matrix<float>(static_cast<int>(offsets.back()), 1);
+    copyHits(slabs, offsets, tensor.coords.data(), tensor.features.data(),
+             static_cast<size_t>(tensor.features.stride()));
+    return tensor;
+}
+
+// 流式加载: 按固定大小的分块 (slab) 顺序读取 .npy 数据, 每块提取完非零体素即丢弃,
+// 峰值内存 = 一个分块 + 稀疏结果, 与体积大小无关. 点按文件存储顺序输出.
+// 总点数读完才知道, 所以特征先收集为连续数组, 最后一次写入特征矩阵
+SparseTensor loadSparseVolumeStreaming(const string& filePath, GridShape& shape, size_t slabBytes) {
+    NpyStream stream(filePath);
+    const NpyHeader& header = stream.header();
+    shape = gridShape(header);
+
+    SparseTensor tensor;
+    vector<float> values;
+    vector<double> slab(max<size_t>(1, slabBytes / sizeof(double)));
+    for (;;) {
+        size_t first = stream.position();
+        size_t count = stream.read(slab.data(), slab.size());
+        if (count == 0) break;
+        vector<SlabHits> hits = extractNonzeros(slab.data(), count, first, header);
+        vector<size_t> offsets = hitOffsets(hits);
+        size_t base = tensor.coords.size();
+        tensor.coords.resize(base + offsets.back());
+        values.resize(base + offsets.back());
+        copyHits(hits, offsets, tensor.coords.data() + base, values.data() + base, 1);
     }
+    tensor.features = featureColumn(values);
+    return tensor;
+}
+
+// 将稀疏张量写成两个 .npy 文件, 各一次顺序写入:
+// <prefix>_coords.npy   int32 N x 4 (batch, x, y, z)
+// <prefix>_features.npy float32 N x C (跳过行尾的对齐填充)
+static_assert(sizeof(Coordinate) == 4 * sizeof(int32_t), "Coordinate must be four packed int32");
 
-    return sparsePoints;
+void writeSparseTensor(const SparseTensor& tensor, const string& prefix) {
+    size_t n = tensor.coords.size();
+    write_npy(prefix + "_coords.npy", reinterpret_cast<const int32_t*>(tensor.coords.data()), {n, 4});
+    write_npy(prefix + "_features.npy", tensor.features.data(), {n, static_cast<size_t>(tensor.channels())},
+              static_cast<size_t>(tensor.features.stride()));
+}
+
+// 简要统计: 点数, 通道数, 坐标包围盒, 特征的最小 / 最大 / 均值
+void printSummary(const SparseTensor& tensor) {
+    cout << "Output Sparse Points: " << tensor.size() << " x " << tensor.channels() << " channels\n";
+    if (tensor.size() == 0) {
+        return;
+    }
+    Coordinate lo = tensor.coords[0], hi = tensor.coords[0];
+    for (const auto& c : tensor.coords) {
+        lo = {min(lo.batch, c.batch), min(lo.x, c.x), min(lo.y, c.y), min(lo.z, c.z)};
+        hi = {max(hi.batch, c.batch), max(hi.x, c.x), max(hi.y, c.y), max(hi.z, c.z)};
+    }
+    float fmin = tensor.features(0, 0), fmax = fmin;
+    double sum = 0.0;
+    for (int i = 0; i < tensor.size(); ++i) {
+        for (int ch = 0; ch < tensor.channels(); ++ch) {
+            float v = tensor.features(i, ch);
+            fmin = min(fmin, v);
+            fmax = max(fmax, v);
+            sum += v;
+        }
+    }
+    cout << "Batches: " << lo.batch << ".." << hi.batch << ", Bounds (" << lo.x << ", " << lo.y << ", " << lo.z
+         << ") - (" << hi.x << ", " << hi.y << ", " << hi.z << ")\n"
+         << "Features: min " << fmin << ", max " << fmax << ", mean "
+         << sum / (static_cast<double>(tensor.size()) * tensor.channels()) << endl;
 }
 
 // 主程序
 int main() {
-    // 输入矩阵参数
-    int height = 64, width = 4096, in_channels = 1;
+    // 输入参数
+    int in_channels = 1;
     int out_channels = 256; // 输出通道数
 
-    // 从 .npy 文件加载稀疏矩阵
+    // 从 .npy 文件加载稀疏体素
     string filePath = "../pointcloud.npy";
-    vector<SparsePoint> inputPoints = loadSparseMatrix(filePath, height, width, in_channels);
-    Kernel kernel = createKernel(3); // 卷积核大小为 3x3
-    vector<vector<float>> weights(in_channels, vector<float>(out_channels, 1.0f)); // 简单初始化为 1.0
-    unordered_map<int, vector<pair<int, int>>> rulebook = createRulebook(inputPoints, kernel, height, width);
-    vector<SparsePoint> outputPoints = submSparseConv(inputPoints, kernel, rulebook, weights, out_channels);
+    size_t slabBytes = 0; // 0: mmap 整个文件; > 0: 以该大小 (例如 4 << 20) 分块流式读取
+    GridShape shape;
+    SparseTensor input = slabBytes == 0 ? loadSparseVolume(filePath, shape)
+                                        : loadSparseVolumeStreaming(filePath, shape, slabBytes);
+    Kernel kernel = createKernel(3); // 卷积核大小为 3x3x3
+    vector<float> weights(kernel.offsets.size() * in_channels * out_channels, 1.0f); // 每个偏移一组权重, 简单初始化为 1.0
+    SparseConvMode mode = SparseConvMode::SUBMANIFOLD; // 常规模式: SparseConvMode::REGULAR
+    int stride = 1;                                     // 仅常规模式可用
+    Rulebook rulebook = mode == SparseConvMode::SUBMANIFOLD
+                            ? createSubmanifoldRulebook(input.coords, kernel, shape)
+                            : createRulebook(input.coords, kernel, shape, stride);
+    SparseTensor output = sparseConv(input, kernel, rulebook, weights, out_channels);
 
-    // 输出结果
-    cout << "Output Sparse Points:" << endl;
-    for (const auto& point : outputPoints) {
-        cout << "Batch: " << point.batch << ", Position (" << point.x << ", " << point.y << "), Features: ";
-        for (float feature : point.features) {
-            cout << feature << " ";
-        }
-        cout << endl;
-    }
+    // 输出结果: 二进制写出, 终端只打印简要统计
+    // (可用 numpy.load("sparse_output_coords.npy") / numpy.load("sparse_output_features.npy") 读取)
+    string outputPrefix = "sparse_output";
+    writeSparseTensor(output, outputPrefix);
+    printSummary(output);
+    cout << "Written: " << outputPrefix << "_coords.npy, " << outputPrefix << "_features.npy" << endl;
 
     return 0;
 }
\ No newline at end of file
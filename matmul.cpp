@@ -1,116 +1,144 @@
-// g++ matmul.cpp -o matmul -std=c++17 -O3 -Wall && ./matmul
+// g++ matmul.cpp gemm.cpp gemm_simd.cpp gemm_tiled.cpp autotune.cpp thread_pool.cpp -o matmul -std=c++17 -pthread -O3 -Wall && ./matmul [--tune] [M [N [K]]]
+// --tune sweeps tile sizes / loop orders / unroll factors for the shape and stores the winner in gemm_tune.txt,
+// which gemm() then picks up on every later run.
+// BENCH_REPS / BENCH_WARMUP / BENCH_OUTPUT=results.json|csv control the benchmark (see bench.h).
 
-#include <sys/time.h>
 #include <iostream>
 #include <cstring>
+#include <cstdlib>
 #include <cassert>
+#include <string>
+#include "autotune.h"
+#include "bench.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "thread_pool.h"
 
-double get_time() {
-  struct timeval tv;
-  gettimeofday(&tv, nullptr);
-  return tv.tv_sec + 1e-6 * tv.tv_usec;
-}
-
-constexpr int n = 1024;
-int A[n][n];
-int B[n][n];
-int BT[n][n];
-int AT[n][n];
-int C[n][n];
-int C_groundtruth[n][n];
+// C[M][N] = A[M][K] * B[K][N], sized at runtime (defaults to 1024 x 1024 x 1024)
+int M = 1024;
+int N = 1024;
+int K = 1024;
+Matrix<int> A;
+Matrix<int> B;
+Matrix<int> BT;
+Matrix<int> AT;
+Matrix<int> C;
+Matrix<int> C_groundtruth;
 
 void init() {
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      A[i][j] = rand(); 
-      B[i][j] = rand(); 
-    } 
+  A = Matrix<int>(M, K);
+  B = Matrix<int>(K, N);
+  AT = Matrix<int>(K, M);
+  BT = Matrix<int>(N, K);
+  C = Matrix<int>(M, N);
+  C_groundtruth = Matrix<int>(M, N);
+  for (int i = 0; i < M; i++) {
+    for (int k = 0; k < K; k++) {
+      A(i, k) = rand();
+    }
   }
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      for (int k = 0; k < n; k++) {
-        C_groundtruth[i][j] += A[i][k] * B[k][j];
+  for (int k = 0; k < K; k++) {
+    for (int j = 0; j < N; j++) {
+      B(k, j) = rand();
+    }
+  }
+  for (int i = 0; i < M; i++) {
+    for (int j = 0; j < N; j++) {
+      for (int k = 0; k < K; k++) {
+        C_groundtruth(i, j) += A(i, k) * B(k, j);
       }
     }
   }
 }
 
 void test() {
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      assert(C[i][j] == C_groundtruth[i][j]);
+  for (int i = 0; i < M; i++) {
+    for (int j = 0; j < N; j++) {
+      assert(C(i, j) == C_groundtruth(i, j));
     }
   }
 }
 
 void matmul() {
-  memset(C, 0, sizeof(C));
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      for (int k = 0; k < n; k++) {
-        C[i][j] += A[i][k] * B[k][j];    
-      }   
+  C.clear();
+  for (int i = 0; i < M; i++) {
+    for (int j = 0; j < N; j++) {
+      for (int k = 0; k < K; k++) {
+        C(i, j) += A(i, k) * B(k, j);
+      }
     }
   }
 }
 
 void matmul_ikj() {
-  memset(C, 0, sizeof(C));
-  for (int i = 0; i < n; i++) {
-    for (int k = 0; k < n; k++) {
-      for (int j = 0; j < n; j++) {
-        C[i][j] += A[i][k] * B[k][j];    
-      }   
+  C.clear();
+  for (int i = 0; i < M; i++) {
+    for (int k = 0; k < K; k++) {
+      for (int j = 0; j < N; j++) {
+        C(i, j) += A(i, k) * B(k, j);
+      }
     }
   }
 }
 
 void matmul_AT() {
-  memset(C, 0, sizeof(C));
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      AT[i][j] = A[j][i];
+  C.clear();
+  for (int i = 0; i < K; i++) {
+    for (int j = 0; j < M; j++) {
+      AT(i, j) = A(j, i);
     }
   }
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      for (int k = 0; k < n; k++) {
-        C[i][j] += AT[k][i] * B[k][j];    
-      }   
+  for (int i = 0; i < M; i++) {
+    for (int j = 0; j < N; j++) {
+      for (int k = 0; k < K; k++) {
+        C(i, j) += AT(k, i) * B(k, j);
+      }
     }
   }
 }
 
 void matmul_BT() {
-  memset(C, 0, sizeof(C));
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      BT[i][j] = B[j][i];
+  C.clear();
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < K; j++) {
+      BT(i, j) = B(j, i);
     }
   }
-  for (int i = 0; i < n; i++) {
-    for (int j = 0; j < n; j++) {
-      for (int k = 0; k < n; k++) {
-        C[i][j] += A[i][k] * BT[j][k];    
-      }   
+  for (int i = 0; i < M; i++) {
+    for (int j = 0; j < N; j++) {
+      for (int k = 0; k < K; k++) {
+        C(i, j) += A(i, k) * BT(j, k);
+      }
     }
   }
 }
 
-int main() {
+void matmul_gemm() {
+  gemm(A, B, C); // Packed, register-blocked GEMM
+}
+
+int main(int argc, char** argv) {
+  bool tune = argc > 1 && strcmp(argv[1], "--tune") == 0;
+  int arg = tune ? 2 : 1;
+  if (argc > arg) M = N = K = atoi(argv[arg]);
+  if (argc > arg + 1) N = atoi(argv[arg + 1]);
+  if (argc > arg + 2) K = atoi(argv[arg + 2]);
+  if (tune) {
+    gemm_autotune<int>(M, N, K, true);
+    return 0;
+  }
   init();
-  float avg_time = 0.0f;
-  for (int K = 0; K < 32; K++) {
-    auto t = get_time();
+  std::string config = "M=" + std::to_string(M) + " N=" + std::to_string(N) + " K=" + std::to_string(K) +
+                       " isa=" + gemm_int_isa() + " threads=" + std::to_string(get_num_threads());
+  double flops = matmul_flops(M, N, K);
+  double bytes = matmul_bytes(M, N, K, sizeof(int));
+  bench_report(benchmark("matmul_gemm", config, [] {
 //     matmul_ikj();
 //     matmul();
 //    matmul_AT();
-     matmul_BT();
-      test();
-//    printf("%f\n", get_time() - t);
-    avg_time += get_time() - t;
-  }
-  printf("Avg Time for Calculation: %f for n size %d \n", avg_time / 32, n);
+//     matmul_BT();
+     matmul_gemm();
+  }, flops, bytes, bench_options(1, 32)));
+  test(); // Verified once, outside the timed region
   return 0;
 }
-
@@ -0,0 +1,119 @@
+//
+// Runtime-sized, heap-backed matrices and strided views over them.
+//
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// Non-owning rows x cols window into a matrix. Element (i, j) lives at
+// data[i * row_stride + j * col_stride], so sub-blocks and transposes are
+// free: they only change the pointer and the strides.
+template <typename T>
+struct MatrixView {
+    T* data = nullptr;
+    int rows = 0;
+    int cols = 0;
+    std::ptrdiff_t row_stride = 0;
+    std::ptrdiff_t col_stride = 1;
+
+    MatrixView() = default;
+    MatrixView(T* data, int rows, int cols, std::ptrdiff_t row_stride, std::ptrdiff_t col_stride = 1)
+        : data(data), rows(rows), cols(cols), row_stride(row_stride), col_stride(col_stride) {}
+
+    T& operator()(int i, int j) const {
+        return data[i * row_stride + j * col_stride];
+    }
+
+    // r x c sub-block starting at (i, j)
+    MatrixView block(int i, int j, int r, int c) const {
+        assert(i >= 0 && j >= 0 && i + r <= rows && j + c <= cols);
+        return MatrixView(data + i * row_stride + j * col_stride, r, c, row_stride, col_stride);
+    }
+
+    MatrixView transposed() const {
+        return MatrixView(data, cols, rows, col_stride, row_stride);
+    }
+
+    operator MatrixView<const T>() const {
+        return MatrixView<const T>(data, rows, cols, row_stride, col_stride);
+    }
+};
+
+// Owning row-major matrix. Storage is 64-byte aligned and every row is padded
+// to a whole number of cache lines, so each row starts on a cache line.
+template <typename T>
+class Matrix {
+public:
+    static constexpr int ALIGNMENT = 64;
+
+    Matrix() = default;
+
+    Matrix(int rows, int cols) : rows_(rows), cols_(cols), stride_(padded_stride(cols)) {
+        std::size_t bytes = static_cast<std::size_t>(rows_) * stride_ * sizeof(T);
+        bytes = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        if (bytes > 0) {
+            data_ = static_cast<T*>(std::aligned_alloc(ALIGNMENT, bytes));
+            std::memset(data_, 0, bytes);
+        }
+    }
+
+    Matrix(const Matrix& other) : Matrix(other.rows_, other.cols_) {
+        if (data_) {
+            std::memcpy(data_, other.data_, static_cast<std::size_t>(rows_) * stride_ * sizeof(T));
+        }
+    }
+
+    Matrix(Matrix&& other) noexcept { swap(other); }
+
+    Matrix& operator=(Matrix other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~Matrix() { std::free(data_); }
+
+    void swap(Matrix& other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(rows_, other.rows_);
+        std::swap(cols_, other.cols_);
+        std::swap(stride_, other.stride_);
+    }
+
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    std::ptrdiff_t stride() const { return stride_; } // Row stride in elements
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+
+    T& operator()(int i, int j) { return data_[i * stride_ + j]; }
+    const T& operator()(int i, int j) const { return data_[i * stride_ + j]; }
+
+    // Zero every element (padding included)
+    void clear() {
+        if (data_) {
+            std::memset(data_, 0, static_cast<std::size_t>(rows_) * stride_ * sizeof(T));
+        }
+    }
+
+    MatrixView<T> view() { return MatrixView<T>(data_, rows_, cols_, stride_); }
+    MatrixView<const T> view() const { return MatrixView<const T>(data_, rows_, cols_, stride_); }
+
+    operator MatrixView<T>() { return view(); }
+    operator MatrixView<const T>() const { return view(); }
+
+private:
+    static std::ptrdiff_t padded_stride(int cols) {
+        constexpr int per_line = ALIGNMENT / sizeof(T) > 0 ? ALIGNMENT / sizeof(T) : 1;
+        return (static_cast<std::ptrdiff_t>(cols) + per_line - 1) / per_line * per_line;
+    }
+
+    T* data_ = nullptr;
+    int rows_ = 0;
+    int cols_ = 0;
+    std::ptrdiff_t stride_ = 0;
+};
@@ -0,0 +1,282 @@
+//
+// NPY readers (memory-mapped and streaming) and writer.
+//
+
+#include "npy.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+size_t NpyHeader::count() const {
+    size_t n = 1;
+    for (size_t d : shape) {
+        n *= d;
+    }
+    return n;
+}
+
+std::vector<ptrdiff_t> NpyHeader::strides() const {
+    std::vector<ptrdiff_t> result(shape.size());
+    ptrdiff_t step = 1;
+    for (size_t i = 0; i < shape.size(); ++i) { // Fastest dimension first
+        size_t d = fortran_order ? i : shape.size() - 1 - i;
+        result[d] = step;
+        step *= static_cast<ptrdiff_t>(shape[d]);
+    }
+    return result;
+}
+
+void NpyHeader::unravel(size_t offset, size_t* index) const {
+    for (size_t i = 0; i < shape.size(); ++i) { // Fastest dimension first
+        size_t d = fortran_order ? i : shape.size() - 1 - i;
+        index[d] = offset % shape[d];
+        offset /= shape[d];
+    }
+}
+
+static std::runtime_error malformed_header() {
+    return std::runtime_error("npy: malformed header");
+}
+
+// Value following 'key': in the header dict, e.g. 'descr': '<f8'
+static std::string dict_value(const std::string& dict, const std::string& key) {
+    size_t pos = dict.find("'" + key + "'");
+    if (pos == std::string::npos) {
+        throw std::runtime_error("npy: header has no '" + key + "'");
+    }
+    pos = dict.find(':', pos);
+    size_t begin = pos == std::string::npos ? pos : dict.find_first_not_of(' ', pos + 1);
+    if (begin == std::string::npos) {
+        throw malformed_header();
+    }
+    size_t end = dict[begin] == '(' ? dict.find(')', begin)
+               : dict[begin] == '\'' ? dict.find('\'', begin + 1)
+               : dict.find_first_of(",}", begin);
+    if (end == std::string::npos) {
+        throw malformed_header();
+    }
+    if (dict[begin] == '(' || dict[begin] == '\'') {
+        ++end; // Keep the closing bracket / quote
+    }
+    return dict.substr(begin, end - begin);
+}
+
+// Decimal header number; stoull's invalid_argument / out_of_range become runtime_error
+static size_t header_number(const std::string& digits) {
+    try {
+        return std::stoull(digits);
+    } catch (const std::logic_error&) {
+        throw malformed_header();
+    }
+}
+
+// Header dicts are a few hundred bytes; a longer length field means a corrupt file
+constexpr size_t NPY_MAX_HEADER = 64 * 1024;
+
+// Checks the magic and version in the first 10 bytes; returns the width of the header
+// length field that follows the version (2 bytes in v1, 4 in v2 / v3)
+static size_t npy_length_bytes(const char* bytes, size_t size) {
+    static const char magic[] = "\x93NUMPY";
+    if (size < 10 || std::memcmp(bytes, magic, 6) != 0) {
+        throw std::runtime_error("npy: not an NPY file");
+    }
+    int major = static_cast<unsigned char>(bytes[6]);
+    if (major < 1 || major > 3) {
+        throw std::runtime_error("npy: unsupported version " + std::to_string(major));
+    }
+    return major == 1 ? 2 : 4;
+}
+
+// Little-endian header length at bytes[8..]; `size` must cover the length field
+static size_t npy_dict_length(const char* bytes, size_t size, size_t length_bytes) {
+    if (size < 8 + length_bytes) {
+        throw std::runtime_error("npy: truncated header");
+    }
+    size_t dict_length = 0;
+    for (size_t i = 0; i < length_bytes; ++i) {
+        dict_length |= static_cast<size_t>(static_cast<unsigned char>(bytes[8 + i])) << (8 * i);
+    }
+    if (dict_length > NPY_MAX_HEADER) {
+        throw std::runtime_error("npy: header length " + std::to_string(dict_length) + " exceeds the limit");
+    }
+    return dict_length;
+}
+
+NpyHeader parse_npy_header(const char* bytes, size_t size) {
+    size_t length_bytes = npy_length_bytes(bytes, size);
+    size_t dict_length = npy_dict_length(bytes, size, length_bytes);
+    size_t dict_offset = 8 + length_bytes;
+    if (dict_offset + dict_length > size) {
+        throw std::runtime_error("npy: truncated header");
+    }
+    std::string dict(bytes + dict_offset, dict_length);
+
+    NpyHeader header;
+    header.data_offset = dict_offset + dict_length;
+
+    std::string descr = dict_value(dict, "descr"); // e.g. '<f8'
+    if (descr.size() < 5) {
+        throw std::runtime_error("npy: unsupported dtype " + descr);
+    }
+    char order = descr[1];
+    if (order == '>') {
+        throw std::runtime_error("npy: big-endian payloads are not supported");
+    }
+    header.kind = descr[2];
+    header.word_size = static_cast<int>(header_number(descr.substr(3, descr.size() - 4)));
+
+    header.fortran_order = dict_value(dict, "fortran_order") == "True";
+
+    std::string shape = dict_value(dict, "shape"); // e.g. (64, 64, 64)
+    for (size_t pos = 1; pos < shape.size();) {
+        size_t digit = shape.find_first_of("0123456789", pos);
+        if (digit == std::string::npos) {
+            break;
+        }
+        size_t end = shape.find_first_not_of("0123456789", digit);
+        header.shape.push_back(header_number(shape.substr(digit, end - digit)));
+        pos = end;
+    }
+    return header;
+}
+
+NpyFile::NpyFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("npy: cannot open " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        throw std::runtime_error("npy: cannot stat " + path);
+    }
+    length_ = static_cast<size_t>(info.st_size);
+    mapping_ = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file alive
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::runtime_error("npy: cannot map " + path);
+    }
+    try {
+        header_ = parse_npy_header(static_cast<const char*>(mapping_), length_);
+        if (header_.data_offset + header_.bytes() > length_) {
+            throw std::runtime_error("npy: truncated payload in " + path);
+        }
+    } catch (...) {
+        munmap(mapping_, length_);
+        throw;
+    }
+    madvise(mapping_, length_, MADV_SEQUENTIAL);
+}
+
+NpyFile::~NpyFile() {
+    if (mapping_) {
+        munmap(mapping_, length_);
+    }
+}
+
+NpyFile::NpyFile(NpyFile&& other) noexcept
+    : mapping_(std::exchange(other.mapping_, nullptr)),
+      length_(std::exchange(other.length_, 0)),
+      header_(std::move(other.header_)) {}
+
+NpyFile& NpyFile::operator=(NpyFile&& other) noexcept {
+    std::swap(mapping_, other.mapping_);
+    std::swap(length_, other.length_);
+    std::swap(header_, other.header_);
+    return *this;
+}
+
+// read() until `bytes` are in or the file ends; returns the bytes read
+static size_t read_fully(int fd, void* dst, size_t bytes) {
+    size_t done = 0;
+    while (done < bytes) {
+        ssize_t n = read(fd, static_cast<char*>(dst) + done, bytes - done);
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+NpyStream::NpyStream(const std::string& path) {
+    fd_ = open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("npy: cannot open " + path);
+    }
+    // Fixed preamble first (magic, version, header length), validated before the
+    // header buffer is sized from it, then the rest of the header
+    std::vector<char> bytes(12);
+    size_t got = read_fully(fd_, bytes.data(), 10);
+    try {
+        size_t length_bytes = npy_length_bytes(bytes.data(), got);
+        got += read_fully(fd_, bytes.data() + got, 8 + length_bytes - got);
+        size_t dict_length = npy_dict_length(bytes.data(), got, length_bytes);
+        bytes.resize(got + dict_length);
+        got += read_fully(fd_, bytes.data() + got, dict_length);
+        header_ = parse_npy_header(bytes.data(), got);
+    } catch (...) {
+        close(fd_);
+        throw;
+    }
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+NpyStream::~NpyStream() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+size_t NpyStream::read_bytes(void* dst, size_t count) {
+    count = std::min(count, header_.count() - position_);
+    size_t bytes = count * header_.word_size;
+    if (read_fully(fd_, dst, bytes) != bytes) {
+        throw std::runtime_error("npy: truncated payload");
+    }
+    position_ += count;
+    return count;
+}
+
+void write_npy_bytes(const std::string& path, const char* descr, const std::vector<size_t>& shape,
+                     const void* data, size_t rows, size_t row_bytes, size_t row_stride_bytes) {
+    std::string dict = std::string("{'descr': '") + descr + "', 'fortran_order': False, 'shape': (";
+    for (size_t d = 0; d < shape.size(); ++d) {
+        dict += std::to_string(shape[d]) + (shape.size() == 1 ? "," : d + 1 < shape.size() ? ", " : "");
+    }
+    dict += "), }";
+    size_t total = 10 + dict.size() + 1; // Version 1.0 preamble + dict + '\n', padded to 64 bytes
+    dict.append((64 - total % 64) % 64, ' ');
+    dict += '\n';
+
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header += static_cast<char>(dict.size() & 0xff);
+    header += static_cast<char>(dict.size() >> 8);
+    header += dict;
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("npy: cannot create " + path);
+    }
+    std::vector<char> buffer(1 << 20); // Rows are staged so the payload goes out in large sequential writes
+    setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+    bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+    const char* bytes = static_cast<const char*>(data);
+    if (row_bytes == row_stride_bytes) {
+        ok = ok && std::fwrite(bytes, 1, rows * row_bytes, file) == rows * row_bytes;
+    } else {
+        for (size_t r = 0; r < rows && ok; ++r) {
+            ok = std::fwrite(bytes + r * row_stride_bytes, 1, row_bytes, file) == row_bytes;
+        }
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        throw std::runtime_error("npy: cannot write " + path);
+    }
+}
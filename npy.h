@@ -0,0 +1,145 @@
+//
+// NPY readers.
+//
+// NpyFile   : the file is mapped read-only, the header is parsed once, and the
+//             payload is exposed as a typed, strided view straight over the
+//             mapping (no copy), in either C or Fortran order. Loading costs
+//             O(header); pages are faulted in only as the view is read.
+// NpyStream : the payload is read front to back in fixed-size slabs into a
+//             caller-owned buffer, so memory stays bounded for any file size.
+// write_npy : one sequential write of a C-order array (header + payload).
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Parsed NPY header (format versions 1.0, 2.0 and 3.0)
+struct NpyHeader {
+    char kind = 0;              // 'f' float, 'i' signed, 'u' unsigned, 'b' bool
+    int word_size = 0;          // Bytes per element
+    bool fortran_order = false;
+    std::vector<size_t> shape;
+    size_t data_offset = 0;     // Payload offset from the start of the file
+
+    size_t count() const;       // Number of elements
+    size_t bytes() const { return count() * word_size; }
+
+    // Element strides (in elements) of every dimension, honouring fortran_order
+    std::vector<ptrdiff_t> strides() const;
+
+    // Logical index (i0, i1, ...) of the element at position `offset` of the payload
+    void unravel(size_t offset, size_t* index) const;
+};
+
+// Parse the header at the start of an NPY file; `size` is how many bytes are available.
+// Throws std::runtime_error on a malformed header or a big-endian payload.
+NpyHeader parse_npy_header(const char* bytes, size_t size);
+
+// dtype tag of T, checked against the header by NpyFile::view<T>() and written by write_npy()
+template <typename T> struct NpyDtype;
+template <> struct NpyDtype<float> { static constexpr char kind = 'f'; static constexpr const char* descr = "<f4"; };
+template <> struct NpyDtype<double> { static constexpr char kind = 'f'; static constexpr const char* descr = "<f8"; };
+template <> struct NpyDtype<int32_t> { static constexpr char kind = 'i'; static constexpr const char* descr = "<i4"; };
+template <> struct NpyDtype<int64_t> { static constexpr char kind = 'i'; static constexpr const char* descr = "<i8"; };
+template <> struct NpyDtype<uint8_t> { static constexpr char kind = 'u'; static constexpr const char* descr = "|u1"; };
+
+// Write `bytes` of payload laid out as `rows` rows of row_bytes, row_stride_bytes apart
+void write_npy_bytes(const std::string& path, const char* descr, const std::vector<size_t>& shape,
+                     const void* data, size_t rows, size_t row_bytes, size_t row_stride_bytes);
+
+// Write a C-order array of the given shape. Rows (the last dimension) may be
+// padded in memory: consecutive rows start row_stride elements apart
+// (0 = packed). Throws std::runtime_error if the file cannot be written.
+template <typename T>
+void write_npy(const std::string& path, const T* data, const std::vector<size_t>& shape, size_t row_stride = 0) {
+    size_t cols = shape.empty() ? 1 : shape.back();
+    size_t rows = 1;
+    for (size_t d = 0; d + 1 < shape.size(); ++d) {
+        rows *= shape[d];
+    }
+    write_npy_bytes(path, NpyDtype<T>::descr, shape, data, rows, cols * sizeof(T),
+                    (row_stride ? row_stride : cols) * sizeof(T));
+}
+
+// Non-owning N-dimensional view: element (i0, i1, ...) lives at data[sum(ik * strides[k])]
+template <typename T>
+struct NpyView {
+    const T* data = nullptr;
+    std::vector<size_t> shape;
+    std::vector<ptrdiff_t> strides;
+
+    size_t dim(int d) const { return d < static_cast<int>(shape.size()) ? shape[d] : 1; }
+    ptrdiff_t stride(int d) const { return d < static_cast<int>(strides.size()) ? strides[d] : 0; }
+
+    const T& operator()(size_t i) const { return data[i * stride(0)]; }
+    const T& operator()(size_t i, size_t j) const { return data[i * stride(0) + j * stride(1)]; }
+    const T& operator()(size_t i, size_t j, size_t k) const {
+        return data[i * stride(0) + j * stride(1) + k * stride(2)];
+    }
+};
+
+// Sequential slab reader over the payload of one NPY file
+class NpyStream {
+public:
+    explicit NpyStream(const std::string& path);
+    ~NpyStream();
+
+    NpyStream(const NpyStream&) = delete;
+    NpyStream& operator=(const NpyStream&) = delete;
+
+    const NpyHeader& header() const { return header_; }
+
+    // Payload position (in elements) of the next element read() returns
+    size_t position() const { return position_; }
+
+    // Read up to `count` elements into dst; returns how many were read (0 at the end).
+    // Throws if T does not match the stored dtype or the file is truncated.
+    template <typename T>
+    size_t read(T* dst, size_t count) {
+        if (header_.kind != NpyDtype<T>::kind || header_.word_size != static_cast<int>(sizeof(T))) {
+            throw std::runtime_error("npy: dtype does not match the requested element type");
+        }
+        return read_bytes(dst, count);
+    }
+
+private:
+    size_t read_bytes(void* dst, size_t count);
+
+    int fd_ = -1;
+    size_t position_ = 0;
+    NpyHeader header_;
+};
+
+// Read-only mapping of one NPY file (move-only, unmapped on destruction)
+class NpyFile {
+public:
+    explicit NpyFile(const std::string& path);
+    ~NpyFile();
+
+    NpyFile(NpyFile&& other) noexcept;
+    NpyFile& operator=(NpyFile&& other) noexcept;
+    NpyFile(const NpyFile&) = delete;
+    NpyFile& operator=(const NpyFile&) = delete;
+
+    const NpyHeader& header() const { return header_; }
+    const void* payload() const { return static_cast<const char*>(mapping_) + header_.data_offset; }
+
+    // Typed view over the payload; throws if T does not match the stored dtype
+    template <typename T>
+    NpyView<T> view() const {
+        if (header_.kind != NpyDtype<T>::kind || header_.word_size != static_cast<int>(sizeof(T))) {
+            throw std::runtime_error("npy: dtype does not match the requested element type");
+        }
+        return NpyView<T>{static_cast<const T*>(payload()), header_.shape, header_.strides()};
+    }
+
+private:
+    void* mapping_ = nullptr;
+    size_t length_ = 0;
+    NpyHeader header_;
+};
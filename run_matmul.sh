@@ -1,2 +1,2 @@
-g++ matmul.cpp -o matmul -std=c++17 -O3 -Wall && ./matmul
+g++ matmul.cpp gemm.cpp gemm_simd.cpp gemm_tiled.cpp autotune.cpp thread_pool.cpp -o matmul -std=c++17 -pthread -O3 -Wall && ./matmul
 rm -rf matmul
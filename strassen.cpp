@@ -1,27 +1,27 @@
 #include <iostream>
 #include <vector>
-#include <sys/time.h>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include "autotune.h"
+#include "bench.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "strassen.h"
+#include "thread_pool.h"
 
 using namespace std;
 
-typedef vector<vector<int>> Matrix;
-
 constexpr int matrix_size = 1024;
-Matrix matrix_A(matrix_size, vector<int>(matrix_size));
-Matrix matrix_B(matrix_size, vector<int>(matrix_size));
-
-// double get_time() {
-//     struct timeval tv;
-//     gettimeofday(&tv, nullptr);
-//     return tv.tv_sec + 1e-6 * tv.tv_usec;
-// }
+Matrix<int> matrix_A(matrix_size, matrix_size);
+Matrix<int> matrix_B(matrix_size, matrix_size);
 
-Matrix generateRandomMatrix(int size) {
+Matrix<int> generateRandomMatrix(int size) {
     srand(static_cast<unsigned int>(time(0)));
-    Matrix matrix(size, vector<int>(size)); // 2D -  vector
+    Matrix<int> matrix(size, size); // 64-byte aligned, heap-backed
     for (int i = 0; i < size; ++i) {
         for (int j = 0; j < size; ++j) {
-            matrix[i][j] = rand(); // Randomized Matrix
+            matrix(i, j) = rand(); // Randomized Matrix
         }
     }
 
@@ -35,73 +35,479 @@ void init(int size)
 
 }
 
-Matrix MatrixAdd(Matrix& A, Matrix& B) {
-    int n = A.size();
-    Matrix C(n, vector<int>(n));
-    for (int i = 0; i < n; ++i)
-        for (int j = 0; j < n; ++j)
-            C[i][j] = A[i][j] + B[i][j]; // Matrix A + Matrix B
-    return C;
+// Crossover to the blocked GEMM: sub-problems of size <= cutoff are not split further.
+// 0 means not configured yet; it is then detected on first use.
+static int strassen_cutoff = 0;
+
+// Arena size for an m x k times k x n product: at every level of the recursion
+// an A-sized operand, a B-sized operand and a C-sized product (the Winograd
+// variant uses less, so one arena fits both). Odd sizes are peeled first.
+size_t strassenWorkspaceSize(int m, int k, int n, int cutoff) {
+    size_t total = 0;
+    while (m > cutoff && k > cutoff && n > cutoff) {
+        int hm = m / 2, hk = k / 2, hn = n / 2;
+        total += StrassenWorkspace::round_up(static_cast<size_t>(hm) * hk);
+        total += StrassenWorkspace::round_up(static_cast<size_t>(hk) * hn);
+        total += StrassenWorkspace::round_up(static_cast<size_t>(hm) * hn);
+        m = hm;
+        k = hk;
+        n = hn;
+    }
+    return total;
 }
 
-Matrix MatrixSubtract(Matrix& A, Matrix& B) {
-    int n = A.size();
-    Matrix C(n, vector<int>(n));
-    for (int i = 0; i < n; ++i)
-        for (int j = 0; j < n; ++j)
-            C[i][j] = A[i][j] - B[i][j]; // Matrix A - Matrix B
-    return C;
+size_t strassenWorkspaceSize(int n, int cutoff) {
+    return strassenWorkspaceSize(n, n, n, cutoff);
+}
+
+StrassenWorkspace StrassenWorkspace::carve(size_t elements) {
+    StrassenWorkspace sub(allocate(elements), round_up(elements));
+    sub.leaf_m = leaf_m;
+    sub.leaf_k = leaf_k;
+    sub.leaf_n = leaf_n;
+    sub.leaf_config = leaf_config;
+    return sub;
+}
+
+int* StrassenWorkspace::allocate(size_t count) {
+    count = round_up(count);
+    if (top + count > size) {
+        cerr << "StrassenWorkspace: arena too small" << endl;
+        abort();
+    }
+    int* data = base + top;
+    top += count;
+    return data;
+}
+
+// Halving (and peeling) always yields the same leaf shape, so one lookup serves every leaf
+const GemmConfig& StrassenWorkspace::leafConfig(int m, int k, int n, int cutoff) {
+    while (m > cutoff && k > cutoff && n > cutoff) {
+        m /= 2;
+        k /= 2;
+        n /= 2;
+    }
+    if (m != leaf_m || k != leaf_k || n != leaf_n) {
+        leaf_config = GemmConfig();
+        find_tuned_config<int>(m, n, k, leaf_config);
+        leaf_m = m;
+        leaf_k = k;
+        leaf_n = n;
+    }
+    return leaf_config;
+}
+
+void MatrixAdd(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C) {
+    for (int i = 0; i < C.rows; ++i)
+        for (int j = 0; j < C.cols; ++j)
+            C(i, j) = A(i, j) + B(i, j); // Matrix A + Matrix B
+}
+
+void MatrixSubtract(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C) {
+    for (int i = 0; i < C.rows; ++i)
+        for (int j = 0; j < C.cols; ++j)
+            C(i, j) = A(i, j) - B(i, j); // Matrix A - Matrix B
+}
+
+void MatrixAccumulate(MatrixView<int> C, MatrixView<const int> P, int sign) {
+    for (int i = 0; i < C.rows; ++i)
+        for (int j = 0; j < C.cols; ++j)
+            C(i, j) += sign * P(i, j); // C += P or C -= P
+}
+
+void MatrixCopy(MatrixView<const int> P, MatrixView<int> C) {
+    for (int i = 0; i < C.rows; ++i)
+        for (int j = 0; j < C.cols; ++j)
+            C(i, j) = P(i, j);
+}
+
+// Peeled strips are thin (one row, column or rank-1 update) and never tuned
+static const GemmConfig peel_config;
+
+typedef void (*StrassenVariant)(MatrixView<const int>, MatrixView<const int>, MatrixView<int>,
+                                StrassenWorkspace&, int);
+
+// Dynamic peeling for odd sizes: run the fast algorithm on the even-sized core
+// and patch the peeled last inner index, column and row with GEMM:
+//   C[0:m', 0:n'] = A[0:m', 0:k'] * B[0:k', 0:n']  (+ rank-1 update when k is odd)
+//   C[:, n']      = A * B[:, n']                    (n odd)
+//   C[m', 0:n']   = A[m', :] * B[:, 0:n']           (m odd)
+template <typename Core>
+static void peeledProduct(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C, Core core) {
+    int m = A.rows, k = A.cols, n = B.cols;
+    int me = m & ~1, ke = k & ~1, ne = n & ~1;
+    core(A.block(0, 0, me, ke), B.block(0, 0, ke, ne), C.block(0, 0, me, ne));
+    if (ke != k) {
+        gemm(A.block(0, ke, me, 1), B.block(ke, 0, 1, ne), C.block(0, 0, me, ne), peel_config, true);
+    }
+    if (ne != n) {
+        gemm(A, B.block(0, ne, k, 1), C.block(0, ne, m, 1), peel_config);
+    }
+    if (me != m) {
+        gemm(A.block(me, 0, 1, k), B.block(0, 0, k, ne), C.block(me, 0, 1, ne), peel_config);
+    }
 }
 
-Matrix StrassenAlgorithm(const Matrix& A, const Matrix& B) {
-    int n = A.size();
-    if (n == 1) {
-        return Matrix{{A[0][0] * B[0][0]}};
-    }
-    int divide = n / 2;
-    Matrix A11(divide, vector<int>(divide)), A12(divide, vector<int>(divide));
-    Matrix A21(divide, vector<int>(divide)), A22(divide, vector<int>(divide));
-    Matrix B11(divide, vector<int>(divide)), B12(divide, vector<int>(divide));
-    Matrix B21(divide, vector<int>(divide)), B22(divide, vector<int>(divide));
-
-    for (int i = 0; i < divide; ++i) { // Calculate A11 to B22
-        for (int j = 0; j < divide; ++j) {
-            A11[i][j] = A[i][j];
-            A12[i][j] = A[i][j + divide];
-            A21[i][j] = A[i + divide][j];
-            A22[i][j] = A[i + divide][j + divide];
-            B11[i][j] = B[i][j];
-            B12[i][j] = B[i][j + divide];
-            B21[i][j] = B[i + divide][j];
-            B22[i][j] = B[i + divide][j + divide];
+// C = A * B for m x k times k x n views. Quadrants are views into the parent
+// matrices; products land directly in the quadrants of C where possible, so a
+// level needs only the TA / TB operands and one product buffer P. Sub-problems
+// with any side <= cutoff go to the blocked GEMM; odd sides are peeled.
+void StrassenAlgorithm(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+                       StrassenWorkspace& workspace, int cutoff) {
+    int m = A.rows, k = A.cols, n = B.cols;
+    if (m <= cutoff || k <= cutoff || n <= cutoff) {
+        gemm(A, B, C, workspace.leafConfig(m, k, n, cutoff));
+        return;
+    }
+    if ((m | k | n) & 1) {
+        peeledProduct(A, B, C, [&](MatrixView<const int> a, MatrixView<const int> b, MatrixView<int> c) {
+            StrassenAlgorithm(a, b, c, workspace, cutoff);
+        });
+        return;
+    }
+    int hm = m / 2, hk = k / 2, hn = n / 2;
+    MatrixView<const int> A11 = A.block(0, 0, hm, hk), A12 = A.block(0, hk, hm, hk);
+    MatrixView<const int> A21 = A.block(hm, 0, hm, hk), A22 = A.block(hm, hk, hm, hk);
+    MatrixView<const int> B11 = B.block(0, 0, hk, hn), B12 = B.block(0, hn, hk, hn);
+    MatrixView<const int> B21 = B.block(hk, 0, hk, hn), B22 = B.block(hk, hn, hk, hn);
+    MatrixView<int> C11 = C.block(0, 0, hm, hn), C12 = C.block(0, hn, hm, hn);
+    MatrixView<int> C21 = C.block(hm, 0, hm, hn), C22 = C.block(hm, hn, hm, hn);
+
+    size_t marker = workspace.mark();
+    MatrixView<int> TA = workspace.take(hm, hk);
+    MatrixView<int> TB = workspace.take(hk, hn);
+    MatrixView<int> P = workspace.take(hm, hn);
+
+    // S4 = (A11 + A12) * B22 -> C12,  S6 = A22 * (B21 - B11) -> C21
+    MatrixAdd(A11, A12, TA);
+    StrassenAlgorithm(TA, B22, C12, workspace, cutoff);
+    MatrixSubtract(B21, B11, TB);
+    StrassenAlgorithm(A22, TB, C21, workspace, cutoff);
+    MatrixSubtract(C21, C12, C11); // C11 = S6 - S4
+
+    // S1 = (A12 - A22) * (B21 + B22)
+    MatrixSubtract(A12, A22, TA);
+    MatrixAdd(B21, B22, TB);
+    StrassenAlgorithm(TA, TB, P, workspace, cutoff);
+    MatrixAccumulate(C11, P, 1);
+
+    // S2 = (A11 + A22) * (B11 + B22)
+    MatrixAdd(A11, A22, TA);
+    MatrixAdd(B11, B22, TB);
+    StrassenAlgorithm(TA, TB, P, workspace, cutoff);
+    MatrixAccumulate(C11, P, 1); // C11 = S1 + S2 - S4 + S6
+    MatrixCopy(P, C22);
+
+    // S5 = A11 * (B12 - B22)
+    MatrixSubtract(B12, B22, TB);
+    StrassenAlgorithm(A11, TB, P, workspace, cutoff);
+    MatrixAccumulate(C12, P, 1); // C12 = S5 + S4
+    MatrixAccumulate(C22, P, 1);
+
+    // S7 = (A21 + A22) * B11
+    MatrixAdd(A21, A22, TA);
+    StrassenAlgorithm(TA, B11, P, workspace, cutoff);
+    MatrixAccumulate(C21, P, 1); // C21 = S7 + S6
+    MatrixAccumulate(C22, P, -1);
+
+    // S3 = (A11 - A21) * (B11 + B12)
+    MatrixSubtract(A11, A21, TA);
+    MatrixAdd(B11, B12, TB);
+    StrassenAlgorithm(TA, TB, P, workspace, cutoff);
+    MatrixAccumulate(C22, P, -1); // C22 = S2 - S3 + S5 - S7
+
+    workspace.release(marker);
+}
+
+// Strassen-Winograd: 7 products and 15 additions (8 on the operands, 7 on the
+// products) instead of 18. Scheduled after Boyer, Dumas, Pernet and Zhou so a
+// level needs just two temporaries: X (A-sized, later holding P1) and Y (B-sized).
+void StrassenWinograd(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+                      StrassenWorkspace& workspace, int cutoff) {
+    int m = A.rows, k = A.cols, n = B.cols;
+    if (m <= cutoff || k <= cutoff || n <= cutoff) {
+        gemm(A, B, C, workspace.leafConfig(m, k, n, cutoff));
+        return;
+    }
+    if ((m | k | n) & 1) {
+        peeledProduct(A, B, C, [&](MatrixView<const int> a, MatrixView<const int> b, MatrixView<int> c) {
+            StrassenWinograd(a, b, c, workspace, cutoff);
+        });
+        return;
+    }
+    int hm = m / 2, hk = k / 2, hn = n / 2;
+    MatrixView<const int> A11 = A.block(0, 0, hm, hk), A12 = A.block(0, hk, hm, hk);
+    MatrixView<const int> A21 = A.block(hm, 0, hm, hk), A22 = A.block(hm, hk, hm, hk);
+    MatrixView<const int> B11 = B.block(0, 0, hk, hn), B12 = B.block(0, hn, hk, hn);
+    MatrixView<const int> B21 = B.block(hk, 0, hk, hn), B22 = B.block(hk, hn, hk, hn);
+    MatrixView<int> C11 = C.block(0, 0, hm, hn), C12 = C.block(0, hn, hm, hn);
+    MatrixView<int> C21 = C.block(hm, 0, hm, hn), C22 = C.block(hm, hn, hm, hn);
+
+    size_t marker = workspace.mark();
+    MatrixView<int> X = workspace.take(hm, max(hk, hn));
+    MatrixView<int> Y = workspace.take(hk, hn);
+    MatrixView<int> XA = X.block(0, 0, hm, hk);
+    MatrixView<int> P1(X.data, hm, hn, hn);
+
+    MatrixSubtract(A11, A21, XA);                      // S3 = A11 - A21
+    MatrixSubtract(B22, B12, Y);                       // T3 = B22 - B12
+    StrassenWinograd(XA, Y, C21, workspace, cutoff);   // P7 = S3 * T3
+    MatrixAdd(A21, A22, XA);                           // S1 = A21 + A22
+    MatrixSubtract(B12, B11, Y);                       // T1 = B12 - B11
+    StrassenWinograd(XA, Y, C22, workspace, cutoff);   // P5 = S1 * T1
+    MatrixSubtract(XA, A11, XA);                       // S2 = S1 - A11
+    MatrixSubtract(B22, Y, Y);                         // T2 = B22 - T1
+    StrassenWinograd(XA, Y, C12, workspace, cutoff);   // P6 = S2 * T2
+    MatrixSubtract(A12, XA, XA);                       // S4 = A12 - S2
+    StrassenWinograd(XA, B22, C11, workspace, cutoff); // P3 = S4 * B22
+    StrassenWinograd(A11, B11, P1, workspace, cutoff); // P1 = A11 * B11
+    MatrixAccumulate(C12, P1, 1);                      // U2 = P1 + P6
+    MatrixAdd(C12, C21, C21);                          // U3 = U2 + P7
+    MatrixAdd(C12, C22, C12);                          // U4 = U2 + P5
+    MatrixAdd(C21, C22, C22);                          // U7 = U3 + P5 = C22
+    MatrixAccumulate(C12, C11, 1);                     // U5 = U4 + P3 = C12
+    MatrixSubtract(Y, B21, Y);                         // T4 = T2 - B21
+    StrassenWinograd(A22, Y, C11, workspace, cutoff);  // P4 = A22 * T4
+    MatrixAccumulate(C21, C11, -1);                    // U6 = U3 - P4 = C21
+    StrassenWinograd(A12, B21, C11, workspace, cutoff); // P2 = A12 * B21
+    MatrixAccumulate(C11, P1, 1);                      // U1 = P1 + P2 = C11
+
+    workspace.release(marker);
+}
+
+// Arena for StrassenParallel: on each of the top spawn_depth levels every one
+// of the seven product tasks gets its own TA, TB, product and sub-arena; below
+// that the sequential layout applies.
+size_t strassenParallelWorkspaceSize(int m, int k, int n, int cutoff, int spawn_depth) {
+    if (spawn_depth <= 0 || m <= cutoff || k <= cutoff || n <= cutoff) {
+        return strassenWorkspaceSize(m, k, n, cutoff);
+    }
+    int hm = m / 2, hk = k / 2, hn = n / 2;
+    size_t per_task = StrassenWorkspace::round_up(static_cast<size_t>(hm) * hk)
+                    + StrassenWorkspace::round_up(static_cast<size_t>(hk) * hn)
+                    + StrassenWorkspace::round_up(static_cast<size_t>(hm) * hn)
+                    + strassenParallelWorkspaceSize(hm, hk, hn, cutoff, spawn_depth - 1);
+    return 7 * per_task;
+}
+
+// Spawn depth that gives every pool thread at least one product task (7^depth >= threads)
+int strassenSpawnDepth() {
+    int threads = get_num_threads();
+    int depth = 0;
+    for (int tasks = 1; tasks < threads; tasks *= 7) {
+        ++depth;
+    }
+    return depth;
+}
+
+// One operand of a Strassen product: first (+/-) second, or first alone when sign == 0
+struct StrassenOperand {
+    MatrixView<const int> first;
+    MatrixView<const int> second;
+    int sign;
+};
+
+// Slot handed to TaskGroup::spawn: binds an index to a shared body. Slots and
+// body live in the spawning frame, which outlives the group's wait().
+template <typename Body>
+struct StrassenTask {
+    const Body* body = nullptr;
+    int index = 0;
+
+    void operator()() const { (*body)(index); }
+};
+
+// Upper bound on the row bands of a combine step (task slots are a fixed array)
+constexpr int MAX_COMBINE_BANDS = 64;
+
+// Task-parallel classic Strassen. On the top spawn_depth levels S1..S7 run as
+// tasks on the work-stealing pool (each forms its own operands, so the operand
+// additions run in parallel too), and the combine into C is split into row
+// bands that run as tasks as well. Deeper levels are the sequential algorithm.
+void StrassenParallel(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+                      StrassenWorkspace& workspace, int cutoff, int spawn_depth) {
+    int m = A.rows, k = A.cols, n = B.cols;
+    if (spawn_depth <= 0 || m <= cutoff || k <= cutoff || n <= cutoff) {
+        StrassenAlgorithm(A, B, C, workspace, cutoff);
+        return;
+    }
+    if ((m | k | n) & 1) {
+        peeledProduct(A, B, C, [&](MatrixView<const int> a, MatrixView<const int> b, MatrixView<int> c) {
+            StrassenParallel(a, b, c, workspace, cutoff, spawn_depth);
+        });
+        return;
+    }
+    int hm = m / 2, hk = k / 2, hn = n / 2;
+    MatrixView<const int> A11 = A.block(0, 0, hm, hk), A12 = A.block(0, hk, hm, hk);
+    MatrixView<const int> A21 = A.block(hm, 0, hm, hk), A22 = A.block(hm, hk, hm, hk);
+    MatrixView<const int> B11 = B.block(0, 0, hk, hn), B12 = B.block(0, hn, hk, hn);
+    MatrixView<const int> B21 = B.block(hk, 0, hk, hn), B22 = B.block(hk, hn, hk, hn);
+
+    const StrassenOperand left[7] = {
+        {A12, A22, -1}, {A11, A22, 1}, {A11, A21, -1}, {A11, A12, 1}, {A11, A11, 0}, {A22, A22, 0}, {A21, A22, 1}};
+    const StrassenOperand right[7] = {
+        {B21, B22, 1}, {B11, B22, 1}, {B11, B12, 1}, {B22, B22, 0}, {B12, B22, -1}, {B21, B11, -1}, {B11, B11, 0}};
+
+    workspace.leafConfig(m, k, n, cutoff); // Resolved here so the carved arenas inherit it
+    size_t marker = workspace.mark();
+    size_t per_task = strassenParallelWorkspaceSize(m, k, n, cutoff, spawn_depth) / 7;
+    MatrixView<int> S[7], TA[7], TB[7];
+    StrassenWorkspace task_workspace[7];
+    auto product = [&](int p) {
+        MatrixView<const int> a = left[p].first, b = right[p].first;
+        if (left[p].sign > 0) MatrixAdd(left[p].first, left[p].second, TA[p]);
+        if (left[p].sign < 0) MatrixSubtract(left[p].first, left[p].second, TA[p]);
+        if (right[p].sign > 0) MatrixAdd(right[p].first, right[p].second, TB[p]);
+        if (right[p].sign < 0) MatrixSubtract(right[p].first, right[p].second, TB[p]);
+        if (left[p].sign != 0) a = TA[p];
+        if (right[p].sign != 0) b = TB[p];
+        StrassenParallel(a, b, S[p], task_workspace[p], cutoff, spawn_depth - 1);
+    };
+    StrassenTask<decltype(product)> product_tasks[7];
+    TaskGroup products;
+    for (int p = 0; p < 7; ++p) {
+        task_workspace[p] = workspace.carve(per_task);
+        TA[p] = task_workspace[p].take(hm, hk);
+        TB[p] = task_workspace[p].take(hk, hn);
+        S[p] = task_workspace[p].take(hm, hn);
+        product_tasks[p] = {&product, p};
+        products.spawn(product_tasks[p]);
+    }
+    products.wait();
+
+    // Combine, one band of rows per task
+    int bands = min({hm, 4 * get_num_threads(), MAX_COMBINE_BANDS});
+    auto combine_band = [&](int band) {
+        int begin = hm * band / bands, end = hm * (band + 1) / bands;
+        for (int i = begin; i < end; ++i) {
+            for (int j = 0; j < hn; ++j) {
+                C(i, j) = S[0](i, j) + S[1](i, j) - S[3](i, j) + S[5](i, j);           // C11 = S1 + S2 - S4 + S6
+                C(i, j + hn) = S[4](i, j) + S[3](i, j);                               // C12 = S5 + S4
+                C(i + hm, j) = S[6](i, j) + S[5](i, j);                               // C21 = S7 + S6
+                C(i + hm, j + hn) = S[1](i, j) - S[2](i, j) + S[4](i, j) - S[6](i, j); // C22 = S2 - S3 + S5 - S7
+            }
         }
+    };
+    StrassenTask<decltype(combine_band)> band_tasks[MAX_COMBINE_BANDS];
+    TaskGroup combine;
+    for (int band = 0; band < bands; ++band) {
+        band_tasks[band] = {&combine_band, band};
+        combine.spawn(band_tasks[band]);
     }
-    // Calculate S1 to S7
-    Matrix S1 = StrassenAlgorithm(MatrixSubtract(A12, A22), MatrixAdd(B21, B22));
-    Matrix S2 = StrassenAlgorithm(MatrixAdd(A11, A22), MatrixAdd(B11, B22));
-    Matrix S3 = StrassenAlgorithm(MatrixSubtract(A11, A21), MatrixAdd(B11, B12));
-    Matrix S4 = StrassenAlgorithm(MatrixAdd(A11, A12), B22);
-    Matrix S5 = StrassenAlgorithm(A11, MatrixSubtract(B12, B22));
-    Matrix S6 = StrassenAlgorithm(A22, MatrixSubtract(B21, B11));
-    Matrix S7 = StrassenAlgorithm(MatrixAdd(A21, A22), B11);
-
-    Matrix Result(n, vector<int>(n));
-    for (int i = 0; i < divide; ++i) { // Update the result by formula
-        for (int j = 0; j < divide; ++j) {
-            Result[i][j] = S1[i][j] + S2[i][j] - S4[i][j] + S6[i][j];
-            Result[i][j + divide] = S5[i][j] + S4[i][j];
-            Result[i + divide][j] = S7[i][j] + S6[i][j];
-            Result[i + divide][j + divide] = S2[i][j] - S3[i][j] + S5[i][j] - S7[i][j];
+    combine.wait();
+
+    workspace.release(marker);
+}
+
+// One level of Strassen over GEMM halves against GEMM on the full matrix, for
+// n = 128, 256, ... 2048. The first n where the split wins gives cutoff n / 2.
+int detectStrassenCutoff() {
+    constexpr int max_size = 2048;
+    for (int n = 128; n <= max_size; n *= 2) {
+        Matrix<int> A = generateRandomMatrix(n);
+        Matrix<int> B = generateRandomMatrix(n);
+        Matrix<int> C(n, n);
+        StrassenWorkspace workspace(strassenWorkspaceSize(n, n / 2));
+        BenchOptions options{1, 3};
+        double time_gemm = benchmark("gemm", "", [&] { gemm(A, B, C); }, 0.0, 0.0, options).min;
+        double time_strassen =
+            benchmark("strassen", "", [&] { StrassenAlgorithm(A, B, C, workspace, n / 2); }, 0.0, 0.0, options).min;
+        if (time_strassen < time_gemm) {
+            return n / 2;
         }
     }
+    return max_size;
+}
+
+void setStrassenCutoff(int cutoff) {
+    strassen_cutoff = max(1, cutoff);
+}
+
+int getStrassenCutoff() {
+    if (strassen_cutoff == 0) {
+        const char* configured = getenv("STRASSEN_CUTOFF");
+        strassen_cutoff = configured ? max(1, atoi(configured)) : detectStrassenCutoff();
+    }
+    return strassen_cutoff;
+}
+
+// Convenience overloads: use the configured / detected cutoff, size the arena
+// for the shape and allocate the result. The classic variant runs task-parallel.
+Matrix<int> StrassenAlgorithm(const Matrix<int>& A, const Matrix<int>& B) {
+    int cutoff = getStrassenCutoff();
+    int spawn_depth = strassenSpawnDepth();
+    Matrix<int> C(A.rows(), B.cols());
+    StrassenWorkspace workspace(strassenParallelWorkspaceSize(A.rows(), A.cols(), B.cols(), cutoff, spawn_depth));
+    StrassenParallel(A, B, C, workspace, cutoff, spawn_depth);
+    return C;
+}
+
+Matrix<int> StrassenWinograd(const Matrix<int>& A, const Matrix<int>& B) {
+    int cutoff = getStrassenCutoff();
+    Matrix<int> C(A.rows(), B.cols());
+    StrassenWorkspace workspace(strassenWorkspaceSize(A.rows(), A.cols(), B.cols(), cutoff));
+    StrassenWinograd(A, B, C, workspace, cutoff);
+    return C;
+}
+
+// Nominal GEMM flops, so Strassen's saving shows up as a higher rate
+static double strassenFlops(int size) { return matmul_flops(size, size, size); }
+static double strassenBytes(int size) { return matmul_bytes(size, size, size, sizeof(int)); }
+
+// Sweep the crossover point: cutoff = size means plain blocked GEMM, every
+// halving adds one level of Strassen on top of it.
+void experiment_cutoff(int size) {
+    init(size);
+    Matrix<int> matrix_C(size, size);
+    for (int cutoff = size; cutoff >= 32; cutoff /= 2) {
+        StrassenWorkspace workspace(strassenWorkspaceSize(size, cutoff));
+        bench_report(benchmark("strassen", "n=" + to_string(size) + " cutoff=" + to_string(cutoff),
+                               [&] { StrassenAlgorithm(matrix_A, matrix_B, matrix_C, workspace, cutoff); },
+                               strassenFlops(size), strassenBytes(size), bench_options(1, 5)));
+    }
+}
 
-    return Result;
+// Classic (18 additions) against Winograd (15 additions) at the detected cutoff;
+// odd sizes exercise the peeling path
+void experiment_variants(int size) {
+    init(size);
+    Matrix<int> matrix_C(size, size);
+    int cutoff = getStrassenCutoff();
+    StrassenWorkspace workspace(strassenWorkspaceSize(size, cutoff));
+    StrassenVariant variants[] = {StrassenAlgorithm, StrassenWinograd};
+    const char* names[] = {"Strassen", "Strassen-Winograd"};
+    for (int v = 0; v < 2; ++v) {
+        bench_report(benchmark(names[v], "n=" + to_string(size) + " cutoff=" + to_string(cutoff),
+                               [&] { variants[v](matrix_A, matrix_B, matrix_C, workspace, cutoff); },
+                               strassenFlops(size), strassenBytes(size), bench_options(1, 5)));
+    }
 }
 
-void printMatrix(const Matrix& mat) {
-    for (const auto& row : mat) {
-        for (const auto& val : row) {
-            cout << val << " ";
+// Task-parallel Strassen across thread counts 1, 2, 4, ... up to the hardware
+void experiment_parallel(int size) {
+    init(size);
+    Matrix<int> matrix_C(size, size);
+    int cutoff = getStrassenCutoff();
+    int max_threads = max(1u, thread::hardware_concurrency());
+    for (int threads = 1; ; threads = min(2 * threads, max_threads)) {
+        set_num_threads(threads);
+        int spawn_depth = strassenSpawnDepth();
+        StrassenWorkspace workspace(strassenParallelWorkspaceSize(size, size, size, cutoff, spawn_depth));
+        bench_report(benchmark("strassen_parallel",
+                               "n=" + to_string(size) + " cutoff=" + to_string(cutoff) + " threads=" +
+                                   to_string(threads) + " spawn_depth=" + to_string(spawn_depth),
+                               [&] { StrassenParallel(matrix_A, matrix_B, matrix_C, workspace, cutoff, spawn_depth); },
+                               strassenFlops(size), strassenBytes(size), bench_options(1, 5)));
+        if (threads == max_threads) {
+            break;
+        }
+    }
+}
+
+void printMatrix(MatrixView<const int> mat) {
+    for (int i = 0; i < mat.rows; ++i) {
+        for (int j = 0; j < mat.cols; ++j) {
+            cout << mat(i, j) << " ";
         }
         cout << endl;
     }
@@ -109,13 +515,15 @@ void printMatrix(const Matrix& mat) {
 
 // int main()
 // {
+//     experiment_cutoff(matrix_size);
+//     experiment_variants(matrix_size - 1);
+//     experiment_parallel(matrix_size);
 //     init(matrix_size);
-//     float avg_time = 0.0f;
-//     for (int K = 0; K < 5; K++) {
-//         auto t = get_time();
-//         StrassenAlgorithm(matrix_A, matrix_B);
-//         avg_time += get_time() - t;
-//     }
-//     printf("Avg Time for Calculation Strassen: %f for n size %d \n", avg_time / 5, matrix_size);
+//     Matrix<int> matrix_C(matrix_size, matrix_size);
+//     int cutoff = getStrassenCutoff();
+//     StrassenWorkspace workspace(strassenWorkspaceSize(matrix_size, cutoff)); // Allocated once, reused by every run
+//     bench_report(benchmark("strassen", "n=" + to_string(matrix_size),
+//                            [&] { StrassenAlgorithm(matrix_A, matrix_B, matrix_C, workspace, cutoff); },
+//                            strassenFlops(matrix_size), strassenBytes(matrix_size), bench_options(1, 5)));
 //     return 0;
-// }
\ No newline at end of file
+// }
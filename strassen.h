@@ -0,0 +1,78 @@
+//
+// Strassen and Strassen-Winograd products over the packed GEMM.
+//
+#pragma once
+
+#include <cstddef>
+#include "gemm.h"
+#include "matrix.h"
+
+// Bump allocator over one buffer that is allocated up front. Every temporary of
+// the recursion is carved from it and handed back in LIFO order, and the leaf
+// GEMM configuration is cached here, so a call never touches the heap
+// (checked by strassen_alloc_test.cpp). Parallel levels carve() a disjoint
+// sub-arena per task.
+class StrassenWorkspace {
+public:
+    StrassenWorkspace() = default; // Empty; assigned a carve() before use
+    explicit StrassenWorkspace(size_t elements)
+        : storage(1, static_cast<int>(round_up(elements))), base(storage.data()), size(elements) {}
+
+    size_t capacity() const { return size; }
+    size_t mark() const { return top; }
+    void release(size_t marker) { top = marker; }
+
+    // rows x cols scratch matrix, each one starting on a cache line
+    MatrixView<int> take(int rows, int cols) {
+        MatrixView<int> view(allocate(static_cast<size_t>(rows) * cols), rows, cols, cols);
+        return view;
+    }
+
+    // Non-owning arena over the next `elements` of this one (inherits the leaf configuration)
+    StrassenWorkspace carve(size_t elements);
+
+    // GEMM configuration for the leaves of an m x k x n product split down to `cutoff`,
+    // looked up in the tuning database only when the leaf shape changes
+    const GemmConfig& leafConfig(int m, int k, int n, int cutoff);
+
+    static size_t round_up(size_t count) {
+        return (count + 15) / 16 * 16; // 16 ints = one 64-byte line
+    }
+
+private:
+    StrassenWorkspace(int* base, size_t elements) : base(base), size(elements) {}
+
+    int* allocate(size_t count);
+
+    Matrix<int> storage; // Empty for carved sub-arenas
+    int* base = nullptr;
+    size_t size = 0;
+    size_t top = 0;
+
+    int leaf_m = -1, leaf_k = -1, leaf_n = -1;
+    GemmConfig leaf_config;
+};
+
+// Arena sizes for the sequential variants and for StrassenParallel
+size_t strassenWorkspaceSize(int m, int k, int n, int cutoff);
+size_t strassenWorkspaceSize(int n, int cutoff);
+size_t strassenParallelWorkspaceSize(int m, int k, int n, int cutoff, int spawn_depth);
+
+// Spawn depth that gives every pool thread at least one product task
+int strassenSpawnDepth();
+
+// C = A * B; sub-problems with a side <= cutoff go to the blocked GEMM
+void StrassenAlgorithm(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+                       StrassenWorkspace& workspace, int cutoff);
+void StrassenWinograd(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+                      StrassenWorkspace& workspace, int cutoff);
+void StrassenParallel(MatrixView<const int> A, MatrixView<const int> B, MatrixView<int> C,
+                      StrassenWorkspace& workspace, int cutoff, int spawn_depth);
+
+// Crossover to the blocked GEMM: $STRASSEN_CUTOFF, else detected on first use
+void setStrassenCutoff(int cutoff);
+int getStrassenCutoff();
+
+// Allocate the result and a workspace, using the configured / detected cutoff
+Matrix<int> StrassenAlgorithm(const Matrix<int>& A, const Matrix<int>& B);
+Matrix<int> StrassenWinograd(const Matrix<int>& A, const Matrix<int>& B);
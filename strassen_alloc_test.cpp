@@ -0,0 +1,80 @@
+//
+// Strassen calls must not allocate once warmed up: operator new is replaced
+// to count every allocation, and a second call on the same workspace has to
+// leave the count unchanged (and match the plain GEMM result).
+//
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "gemm.h"
+#include "matrix.h"
+#include "strassen.h"
+#include "thread_pool.h"
+
+static std::atomic<long> allocations{0};
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+static Matrix<int> randomMatrix(int rows, int cols) {
+    Matrix<int> matrix(rows, cols);
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            matrix(i, j) = rand() % 7 - 3;
+        }
+    }
+    return matrix;
+}
+
+// Warm up once (pool threads, pack buffers, tuning database), then count a second call
+template <typename Run>
+static int check(const char* name, int n, int threads, Run run) {
+    Matrix<int> A = randomMatrix(n, n), B = randomMatrix(n, n), C(n, n), expected(n, n);
+    gemm(A, B, expected);
+    run(A, B, C);
+    long before = allocations.load();
+    run(A, B, C);
+    long count = allocations.load() - before;
+    bool correct = true;
+    for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+            correct = correct && C(i, j) == expected(i, j);
+        }
+    }
+    printf("%s n=%d, %d threads: %ld allocations%s\n", name, n, threads, count, correct ? "" : ", WRONG RESULT");
+    return count == 0 && correct ? 0 : 1;
+}
+
+int main() {
+    setenv("GEMM_TUNE_DB", "/dev/null", 1); // Default configurations, whatever is in the working directory
+    const int cutoff = 64;
+    int failures = 0;
+    for (int threads : {1, 4, 16}) {
+        set_num_threads(threads);
+        for (int n : {512, 255}) {
+            StrassenWorkspace workspace(strassenWorkspaceSize(n, cutoff));
+            failures += check("StrassenAlgorithm", n, threads, [&](const Matrix<int>& A, const Matrix<int>& B, Matrix<int>& C) {
+                StrassenAlgorithm(A, B, C, workspace, cutoff);
+            });
+            failures += check("StrassenWinograd", n, threads, [&](const Matrix<int>& A, const Matrix<int>& B, Matrix<int>& C) {
+                StrassenWinograd(A, B, C, workspace, cutoff);
+            });
+            int spawn_depth = strassenSpawnDepth();
+            StrassenWorkspace parallel_workspace(strassenParallelWorkspaceSize(n, n, n, cutoff, spawn_depth));
+            failures += check("StrassenParallel", n, threads, [&](const Matrix<int>& A, const Matrix<int>& B, Matrix<int>& C) {
+                StrassenParallel(A, B, C, parallel_workspace, cutoff, spawn_depth);
+            });
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
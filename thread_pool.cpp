@@ -0,0 +1,203 @@
+//
+// Persistent worker pool shared by the parallel kernels.
+//
+
+#include "thread_pool.h"
+#include <algorithm>
+
+static thread_local bool inside_task = false; // Nested parallel_for calls run inline
+static thread_local int queue_index = 0;       // Own deque: 0 outside the pool, i on worker i
+
+ThreadPool::ThreadPool(int num_threads) {
+    start(num_threads);
+}
+
+ThreadPool::~ThreadPool() {
+    stop();
+}
+
+void ThreadPool::start(int num_threads) {
+    stopping = false;
+    queues.clear();
+    for (int i = 0; i < std::max(1, num_threads); ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (int i = 1; i < std::max(1, num_threads); ++i) {
+        workers.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void ThreadPool::resize(int num_threads) {
+    std::lock_guard<std::mutex> call_lock(call_mutex);
+    stop();
+    start(num_threads);
+}
+
+// task / count are the caller's copies of job / job_count, taken under the mutex
+void ThreadPool::run_tasks(FunctionRef<void(int)> task, int count) {
+    inside_task = true;
+    for (int i = next_index.fetch_add(1); i < count; i = next_index.fetch_add(1)) {
+        task(i);
+    }
+    inside_task = false;
+}
+
+void ThreadPool::worker_loop(int index) {
+    queue_index = index;
+    long seen = 0;
+    while (true) {
+        FunctionRef<void(int)> task;
+        int count;
+        if (run_one_task()) {
+            continue;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen || queued_tasks.load() > 0; });
+            if (stopping) {
+                return;
+            }
+            if (generation == seen) { // Woken for queued tasks
+                continue;
+            }
+            seen = generation;
+            if (!job) { // Woken after that job drained: join nothing, next_index may already be the next job's
+                continue;
+            }
+            task = job;
+            count = job_count;
+            ++busy_workers;
+        }
+        run_tasks(task, count);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busy_workers;
+        }
+        done.notify_one();
+    }
+}
+
+void ThreadPool::parallel_for(int count, FunctionRef<void(int)> task) {
+    if (count <= 0) {
+        return;
+    }
+    if (inside_task || workers.empty() || count == 1) {
+        for (int i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(call_mutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = task;
+        job_count = count;
+        next_index.store(0);
+        ++generation;
+    }
+    wake.notify_all();
+
+    run_tasks(task, count);
+
+    // Every index has been claimed; wait for the workers still finishing theirs
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return busy_workers == 0; });
+    job = FunctionRef<void(int)>();
+}
+
+bool ThreadPool::push_task(FunctionRef<void()> task, std::atomic<int>* pending) {
+    TaskQueue& queue = *queues[queue_index % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tail - queue.head == TaskQueue::CAPACITY) {
+            return false;
+        }
+        queue.ring[queue.tail++ % TaskQueue::CAPACITY] = {task, pending};
+    }
+    queued_tasks.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(mutex); // Pairs with the predicate check in worker_loop
+    }
+    wake.notify_one();
+    return true;
+}
+
+bool ThreadPool::run_one_task() {
+    if (queued_tasks.load() == 0) {
+        return false;
+    }
+    Task task;
+    int count = static_cast<int>(queues.size());
+    int self = queue_index % count;
+    for (int i = 0; i < count && !task.run; ++i) {
+        TaskQueue& queue = *queues[(self + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.head == queue.tail) {
+            continue;
+        }
+        if (i == 0) { // Own deque: LIFO keeps the working set hot
+            task = queue.ring[--queue.tail % TaskQueue::CAPACITY];
+        } else {      // Steal the oldest, i.e. the biggest, piece of work
+            task = queue.ring[queue.head++ % TaskQueue::CAPACITY];
+        }
+    }
+    if (!task.run) {
+        return false;
+    }
+    queued_tasks.fetch_sub(1);
+    bool was_inside = inside_task;
+    inside_task = true;
+    task.run();
+    inside_task = was_inside;
+    task.pending->fetch_sub(1);
+    return true;
+}
+
+TaskGroup::TaskGroup(ThreadPool& pool) : pool(pool) {}
+
+TaskGroup::TaskGroup() : pool(global_thread_pool()) {}
+
+void TaskGroup::spawn(FunctionRef<void()> task) {
+    pending.fetch_add(1);
+    if (!pool.push_task(task, &pending)) {
+        task();
+        pending.fetch_sub(1);
+    }
+}
+
+void TaskGroup::wait() {
+    while (pending.load() > 0) {
+        if (!pool.run_one_task()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+ThreadPool& global_thread_pool() {
+    static ThreadPool pool(static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+    return pool;
+}
+
+void set_num_threads(int num_threads) {
+    ThreadPool& pool = global_thread_pool();
+    if (num_threads != pool.size()) {
+        pool.resize(num_threads);
+    }
+}
+
+int get_num_threads() {
+    return global_thread_pool().size();
+}
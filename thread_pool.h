@@ -0,0 +1,136 @@
+//
+// Persistent worker pool shared by the parallel kernels.
+//
+// Two ways to hand it work:
+//   parallel_for : a flat range of indices, shared out dynamically
+//   TaskGroup    : recursive fork / join on per-thread work-stealing deques
+// Neither allocates per call: callables are passed by reference (FunctionRef)
+// and the deques are fixed-capacity rings set up when the pool starts.
+//
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Non-owning reference to a callable: an object pointer and a thunk, so passing
+// a lambda never allocates. The callable must outlive every call through the ref.
+template <typename Signature>
+class FunctionRef;
+
+template <typename R, typename... Args>
+class FunctionRef<R(Args...)> {
+public:
+    FunctionRef() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, FunctionRef>>>
+    FunctionRef(F&& f)
+        : object(const_cast<void*>(static_cast<const void*>(std::addressof(f)))),
+          thunk([](void* o, Args... args) -> R {
+              return (*static_cast<std::remove_reference_t<F>*>(o))(std::forward<Args>(args)...);
+          }) {}
+
+    R operator()(Args... args) const { return thunk(object, std::forward<Args>(args)...); }
+    explicit operator bool() const { return thunk != nullptr; }
+
+private:
+    void* object = nullptr;
+    R (*thunk)(void*, Args...) = nullptr;
+};
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads taking part in a parallel_for (workers + the caller)
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+
+    // Restart the pool with a new thread count (must not be called from inside a task)
+    void resize(int num_threads);
+
+    // Run task(0) .. task(count - 1) across the pool and block until all are done.
+    // The calling thread works too; calls made from inside a task run inline.
+    void parallel_for(int count, FunctionRef<void(int)> task);
+
+    // Push a task on the calling thread's deque (see TaskGroup); `pending` is
+    // decremented once it has run. Returns false, queueing nothing, if the deque is full.
+    bool push_task(FunctionRef<void()> task, std::atomic<int>* pending);
+
+    // Run one queued task: newest from the own deque, else the oldest stolen
+    // from another thread. Returns false if every deque was empty.
+    bool run_one_task();
+
+private:
+    struct Task {
+        FunctionRef<void()> run;
+        std::atomic<int>* pending = nullptr;
+    };
+
+    // Ring buffer of tasks: [head, tail) are queued, positions taken modulo the capacity
+    struct TaskQueue {
+        static constexpr size_t CAPACITY = 256;
+        std::mutex mutex;
+        Task ring[CAPACITY];
+        size_t head = 0;
+        size_t tail = 0;
+    };
+
+    void start(int num_threads);
+    void stop();
+    void worker_loop(int index);
+    void run_tasks(FunctionRef<void(int)> task, int count);
+
+    std::vector<std::thread> workers;
+    std::mutex call_mutex;          // one parallel_for at a time
+    std::mutex mutex;
+    std::condition_variable wake;   // workers wait for a new job here
+    std::condition_variable done;   // caller waits for the job to drain here
+
+    FunctionRef<void(int)> job;     // Null once the last job has drained
+    int job_count = 0;
+    long generation = 0;
+    std::atomic<int> next_index{0};
+    int busy_workers = 0;
+    bool stopping = false;
+
+    std::vector<std::unique_ptr<TaskQueue>> queues; // [0] for outside threads, [i] for worker i
+    std::atomic<int> queued_tasks{0};
+};
+
+// Fork / join scope on the pool's work-stealing deques. wait() (also run by the
+// destructor) does not block idle: the waiting thread keeps running queued
+// tasks, its own first, until every task spawned through this group is done.
+// spawn() keeps only a reference: the task must stay alive until wait() returns.
+// If the calling thread's deque is full the task runs inline instead.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool);
+    TaskGroup();
+    ~TaskGroup() { wait(); }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void spawn(FunctionRef<void()> task);
+    void wait();
+
+private:
+    ThreadPool& pool;
+    std::atomic<int> pending{0};
+};
+
+// Process-wide pool used by gemm() and friends
+ThreadPool& global_thread_pool();
+
+// Thread count of the global pool (defaults to std::thread::hardware_concurrency())
+void set_num_threads(int num_threads);
+int get_num_threads();
@@ -0,0 +1,32 @@
+//
+// Back-to-back parallel_for calls of changing sizes: every index of every job
+// must run exactly once, even when a worker wakes after its job has drained.
+//
+
+#include <atomic>
+#include <cstdio>
+#include "thread_pool.h"
+
+int main() {
+    const int max_count = 97;
+    std::atomic<int> runs[max_count];
+    int failures = 0;
+    for (int threads : {2, 4, 16}) {
+        ThreadPool pool(threads);
+        for (int call = 0; call < 20000; ++call) {
+            int count = 1 + call * 37 % max_count;
+            for (int i = 0; i < count; ++i) {
+                runs[i].store(0, std::memory_order_relaxed);
+            }
+            pool.parallel_for(count, [&](int i) { runs[i].fetch_add(1, std::memory_order_relaxed); });
+            for (int i = 0; i < count; ++i) {
+                if (runs[i].load() != 1) {
+                    printf("%d threads, call %d: index %d of %d ran %d times\n", threads, call, i, count, runs[i].load());
+                    ++failures;
+                }
+            }
+        }
+        printf("%d threads: %s\n", threads, failures == 0 ? "ok" : "FAILED");
+    }
+    return failures == 0 ? 0 : 1;
+}
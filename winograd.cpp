@@ -3,134 +3,730 @@
 #include <cstdlib>
 #include <ctime>
 #include <stdlib.h>
-#include <sys/time.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <string>
+#include "bench.h"
+#include "gemm.h"
+#include "thread_pool.h"
+#include "winograd.h"
 using namespace std;
 
-double get_time() {
-    struct timeval tv;
-    gettimeofday(&tv, nullptr);
-    return tv.tv_sec + 1e-6 * tv.tv_usec;
+// NCHW, NHWC and NCHWc are all [N][C / c][H][W][c] with channel block c = 1, C and 8 / 16;
+// blocked layouts pad the channel count up to a whole number of blocks
+int layout_channel_block(TensorLayout layout, int channels)
+{
+    switch (layout)
+    {
+        case TensorLayout::NHWC: return max(channels, 1);
+        case TensorLayout::NCHW8c: return 8;
+        case TensorLayout::NCHW16c: return 16;
+        default: return 1;
+    }
+}
+
+size_t layout_size(TensorLayout layout, int batch_size, int channels, int height, int width)
+{
+    int block = layout_channel_block(layout, channels);
+    size_t padded_channels = static_cast<size_t>(channels + block - 1) / block * block;
+    return static_cast<size_t>(batch_size) * padded_channels * height * width;
+}
+
+const char* layout_name(TensorLayout layout)
+{
+    switch (layout)
+    {
+        case TensorLayout::NCHW: return "NCHW";
+        case TensorLayout::NHWC: return "NHWC";
+        case TensorLayout::NCHW8c: return "NCHW8c";
+        case TensorLayout::NCHW16c: return "NCHW16c";
+    }
+    return "?";
+}
+
+// dst[j * dst_ld + i] = src[i * src_ld + j] for a rows x cols block, walked in 8 x 8 tiles
+static void transpose_block(const float* src, int rows, int cols, ptrdiff_t src_ld, float* dst, ptrdiff_t dst_ld)
+{
+    constexpr int TILE = 8;
+    for (int i0 = 0; i0 < rows; i0 += TILE)
+    {
+        for (int j0 = 0; j0 < cols; j0 += TILE)
+        {
+            int i_end = min(i0 + TILE, rows);
+            int j_end = min(j0 + TILE, cols);
+            for (int j = j0; j < j_end; ++j)
+            {
+                for (int i = i0; i < i_end; ++i)
+                {
+                    dst[j * dst_ld + i] = src[i * src_ld + j];
+                }
+            }
+        }
+    }
+}
+
+void convert_layout(const float* src, TensorLayout from, vector<float>& dst, TensorLayout to,
+                    int batch_size, int channels, int height, int width)
+{
+    int plane = height * width;
+    int src_block = layout_channel_block(from, channels);
+    int dst_block = layout_channel_block(to, channels);
+    int src_blocks = (channels + src_block - 1) / src_block;
+    int dst_blocks = (channels + dst_block - 1) / dst_block;
+    dst.assign(layout_size(to, batch_size, channels, height, width), 0.0f); // Padding channels stay zero
+    if (from == to)
+    {
+        memcpy(dst.data(), src, dst.size() * sizeof(float));
+        return;
+    }
+
+    global_thread_pool().parallel_for(batch_size, [&](int b) {
+        const float* image = src + static_cast<size_t>(b) * src_blocks * src_block * plane;
+        float* out = dst.data() + static_cast<size_t>(b) * dst_blocks * dst_block * plane;
+        if (from == TensorLayout::NCHW || to == TensorLayout::NCHW)
+        {
+            // Each c-block is a (H*W) x c slab; in NCHW the same channels are c rows of H*W
+            bool to_blocked = from == TensorLayout::NCHW;
+            int block = to_blocked ? dst_block : src_block;
+            int blocks = to_blocked ? dst_blocks : src_blocks;
+            for (int k = 0; k < blocks; ++k)
+            {
+                int count = min(block, channels - k * block);
+                size_t slab = static_cast<size_t>(k) * block * plane;
+                if (to_blocked)
+                {
+                    transpose_block(image + slab, count, plane, plane, out + slab, block);
+                }
+                else
+                {
+                    transpose_block(image + slab, plane, count, block, out + slab, plane);
+                }
+            }
+            return;
+        }
+        // Blocked to blocked: copy the runs of channels that are contiguous in both layouts
+        for (int p = 0; p < plane; ++p)
+        {
+            for (int c = 0; c < channels;)
+            {
+                int run = min({src_block - c % src_block, dst_block - c % dst_block, channels - c});
+                memcpy(out + (static_cast<size_t>(c / dst_block) * plane + p) * dst_block + c % dst_block,
+                       image + (static_cast<size_t>(c / src_block) * plane + p) * src_block + c % src_block,
+                       run * sizeof(float));
+                c += run;
+            }
+        }
+    });
+}
+
+// GEMM epilogue for one image of a convolution whose product is rows x cols (row stride ld).
+// Output channels run along the rows (NCHW) or along the columns (NHWC).
+static GemmEpilogue image_epilogue(const ConvEpilogue& epilogue, size_t image_offset,
+                                   int rows, int cols, ptrdiff_t ld, bool channels_per_row)
+{
+    GemmEpilogue result;
+    result.bias = epilogue.bias;
+    result.bias_per_row = channels_per_row;
+    if (epilogue.residual)
+    {
+        result.residual = MatrixView<const float>(epilogue.residual + image_offset, rows, cols, ld);
+    }
+    result.activation = epilogue.activation;
+    result.clamp_min = epilogue.clamp_min;
+    result.clamp_max = epilogue.clamp_max;
+    return result;
 }
 
+// Lower one input plane into its K*K rows of the im2col matrix. For every tap
+// (kh, kw) and output row, the taps that fall inside the image form one run:
+// the padding on either side is zero-filled and the run is copied in one go
+// (memcpy for stride 1). KS / S fix kernel size and stride at compile time (0 = runtime).
+template <int KS, int S>
+static void im2col_plane(const float* plane, int height, int width, int kernel_size, int stride, int padding,
+                         int out_height, int out_width, float* rows)
+{
+    const int k_size = KS ? KS : kernel_size;
+    const int s = S ? S : stride;
+    int out_size = out_height * out_width;
+    for (int kh = 0; kh < k_size; ++kh)
+    {
+        for (int kw = 0; kw < k_size; ++kw)
+        {
+            float* row = rows + static_cast<size_t>(kh * k_size + kw) * out_size;
+            // Output columns whose input column w = ow * s + kw - padding is inside the image
+            int ow_begin = min(out_width, max(0, (padding - kw + s - 1) / s));
+            int ow_end = max(ow_begin, min(out_width, (width - 1 + padding - kw) / s + 1));
+            if (width - 1 + padding - kw < 0)
+            {
+                ow_end = ow_begin;
+            }
+            for (int oh = 0; oh < out_height; ++oh)
+            {
+                float* dst = row + oh * out_width;
+                int h_in = oh * s + kh - padding;
+                if (h_in < 0 || h_in >= height) // Padding row
+                {
+                    memset(dst, 0, out_width * sizeof(float));
+                    continue;
+                }
+                memset(dst, 0, ow_begin * sizeof(float));
+                const float* src = plane + h_in * width + kw - padding;
+                if (s == 1)
+                {
+                    memcpy(dst + ow_begin, src + ow_begin, (ow_end - ow_begin) * sizeof(float));
+                }
+                else
+                {
+                    for (int ow = ow_begin; ow < ow_end; ++ow)
+                    {
+                        dst[ow] = src[ow * s];
+                    }
+                }
+                memset(dst + ow_end, 0, (out_width - ow_end) * sizeof(float));
+            }
+        }
+    }
+}
+
+// Layout per image: C*K*K rows (c, kh, kw) x OH*OW columns (oh, ow), so every row is
+// a contiguous run of output pixels and the matrix is the GEMM B operand as is.
+// Planes (image, channel) are lowered in parallel.
 void im2col(const float* input, int batch_size, int height, int width, int channels,
             int kernel_size, int stride, int padding,
             vector<float>& output)
 {
     int out_height = (height + 2 * padding - kernel_size) / stride + 1; // out h
     int out_width = (width + 2 * padding - kernel_size) / stride + 1; // out w
+    int out_size = out_height * out_width;
+    int taps = kernel_size * kernel_size;
+    output.resize(static_cast<size_t>(batch_size) * channels * taps * out_size);
 
-    int channel_size = height * width; // points per channel
-    int output_col_size = channels * kernel_size * kernel_size;
-    output.resize(batch_size * out_height * out_width * output_col_size);
-
-    int output_index = 0;
-    int input_index = 0;
-    for (int b = 0; b < batch_size; b++)
+    auto lower = im2col_plane<0, 0>;
+    if (kernel_size == 3 && stride == 1)
     {
-        for (int c = 0; c < channels; ++c)
+        lower = im2col_plane<3, 1>;
+    }
+    else if (stride == 1)
+    {
+        lower = im2col_plane<0, 1>;
+    }
+    global_thread_pool().parallel_for(batch_size * channels, [&](int plane) {
+        lower(input + static_cast<size_t>(plane) * height * width, height, width, kernel_size, stride, padding,
+              out_height, out_width, output.data() + static_cast<size_t>(plane) * taps * out_size);
+    });
+}
+
+// Channel-blocked layouts (NHWC, NCHWc) are lowered the other way round: per image
+// OH*OW rows (oh, ow) x C/c*K*K*c columns (channel block, kh, kw, c), because there
+// every tap is a contiguous vector of c channels that is copied in one go.
+static void im2col_blocked(const float* input, int batch_size, int height, int width, int channels,
+                           int kernel_size, int stride, int padding, TensorLayout layout,
+                           vector<float>& output)
+{
+    int out_height = (height + 2 * padding - kernel_size) / stride + 1;
+    int out_width = (width + 2 * padding - kernel_size) / stride + 1;
+    int block = layout_channel_block(layout, channels);
+    int blocks = (channels + block - 1) / block;
+    size_t row_size = static_cast<size_t>(blocks) * kernel_size * kernel_size * block;
+    size_t image_size = static_cast<size_t>(blocks) * block * height * width;
+    output.resize(static_cast<size_t>(batch_size) * out_height * out_width * row_size);
+
+    global_thread_pool().parallel_for(batch_size * out_height, [&](int task) {
+        int b = task / out_height;
+        int oh = task % out_height;
+        for (int ow = 0; ow < out_width; ++ow)
         {
-            for (int h = 0; h < out_height; ++h)
+            float* dst = output.data() + ((static_cast<size_t>(b) * out_height + oh) * out_width + ow) * row_size;
+            for (int k = 0; k < blocks; ++k)
             {
-                for (int w = 0; w < out_width; ++w)
+                const float* slab = input + b * image_size + static_cast<size_t>(k) * block * height * width;
+                for (int kh = 0; kh < kernel_size; ++kh)
                 {
-                    for (int kh = 0; kh < kernel_size; ++kh)
+                    int h_in = oh * stride + kh - padding;
+                    for (int kw = 0; kw < kernel_size; ++kw, dst += block)
                     {
-                        for (int kw = 0; kw < kernel_size; ++kw)
+                        int w_in = ow * stride + kw - padding;
+                        if (h_in < 0 || h_in >= height || w_in < 0 || w_in >= width)
                         {
-                            int h_in = h * stride + kh; // h index traced from original 2D Feature Map
-                            int w_in = w * stride + kw; // w index traced from original 2D Feature Map
-                            int in_batch_start = b * channel_size * channels;
-                            input_index = in_batch_start + c * channel_size + h_in * width + w_in; // Calculate input index
-
-                            int out_batch_start = b * out_height * out_width * output_col_size; // Locate Current Batch
-                            int out_channel_start = (c * kernel_size * kernel_size); // Locate Current Channel
-                            int row_start = (h * out_width + w) * output_col_size; // Locate Current Row
-                            int kernel_start = (kh * kernel_size + kw); // Locate index in this Row
-                            output_index = out_batch_start + out_channel_start + row_start + kernel_start;
-
-                            if (h_in < height && w_in < width) // Check if the padding area from input feature map
-                            {
-                                output[output_index] = input[input_index];
-                            }
-                            else
-                            {
-                                output[output_index] = 0;
-                            }
+                            memset(dst, 0, block * sizeof(float));
+                            continue;
                         }
+                        memcpy(dst, slab + (static_cast<size_t>(h_in) * width + w_in) * block, block * sizeof(float));
                     }
                 }
             }
         }
+    });
+}
+
+void im2col(const float* input, int batch_size, int height, int width, int channels,
+            int kernel_size, int stride, int padding,
+            vector<float>& output, TensorLayout layout)
+{
+    if (layout == TensorLayout::NCHW)
+    {
+        im2col(input, batch_size, height, width, channels, kernel_size, stride, padding, output);
+        return;
+    }
+    im2col_blocked(input, batch_size, height, width, channels, kernel_size, stride, padding, layout, output);
+}
+
+// Blocked-layout convolution: out (OH*OW x OC) = lowered (OH*OW x C/c*K*K*c) * W, with W the
+// OIHW kernels reordered to match the lowered columns. The product is split into the
+// output channel blocks afterwards (NHWC is written in place).
+static void convolution_blocked(const float* input, int batch_size, int height, int width, int channels,
+                                const vector<float>& kernels, int out_channels, int kernel_size,
+                                int stride, int padding, vector<float>& output, TensorLayout layout,
+                                const ConvEpilogue& epilogue)
+{
+    int out_height = (height + 2 * padding - kernel_size) / stride + 1;
+    int out_width = (width + 2 * padding - kernel_size) / stride + 1;
+    int out_size = out_height * out_width;
+    int taps = kernel_size * kernel_size;
+    int block = layout_channel_block(layout, channels);
+    int blocks = (channels + block - 1) / block;
+    int out_block = layout_channel_block(layout, out_channels);
+    int out_blocks = (out_channels + out_block - 1) / out_block;
+    int col_size = blocks * taps * block;
+
+    thread_local vector<float> weights; // (channel block, kh, kw, c) x OC
+    weights.assign(static_cast<size_t>(col_size) * out_channels, 0.0f);
+    for (int oc = 0; oc < out_channels; ++oc)
+    {
+        for (int c = 0; c < channels; ++c)
+        {
+            for (int t = 0; t < taps; ++t)
+            {
+                int row = (c / block * taps + t) * block + c % block;
+                weights[static_cast<size_t>(row) * out_channels + oc] = kernels[(static_cast<size_t>(oc) * channels + c) * taps + t];
+            }
+        }
+    }
+
+    thread_local vector<float> lowered;
+    im2col_blocked(input, batch_size, height, width, channels, kernel_size, stride, padding, layout, lowered);
+    output.assign(layout_size(layout, batch_size, out_channels, out_height, out_width), 0.0f);
+    thread_local vector<float> product; // OH*OW x OC, split into c-blocks afterwards
+    product.resize(static_cast<size_t>(out_size) * out_channels);
+    for (int b = 0; b < batch_size; ++b)
+    {
+        MatrixView<const float> A(lowered.data() + static_cast<size_t>(b) * out_size * col_size, out_size, col_size, col_size);
+        MatrixView<const float> B(weights.data(), col_size, out_channels, out_channels);
+        size_t image_offset = static_cast<size_t>(b) * out_blocks * out_block * out_size;
+        float* image = output.data() + image_offset;
+        if (out_blocks == 1) // NHWC: the product is the output image
+        {
+            gemm(A, B, MatrixView<float>(image, out_size, out_channels, out_block),
+                 image_epilogue(epilogue, image_offset, out_size, out_channels, out_block, false));
+            continue;
+        }
+        gemm(A, B, MatrixView<float>(product.data(), out_size, out_channels, out_channels));
+        for (int k = 0; k < out_blocks; ++k) // The epilogue is fused into the split
+        {
+            int count = min(out_block, out_channels - k * out_block);
+            for (int p = 0; p < out_size; ++p)
+            {
+                size_t offset = (static_cast<size_t>(k) * out_size + p) * out_block;
+                const float* src = product.data() + static_cast<size_t>(p) * out_channels + k * out_block;
+                for (int c = 0; c < count; ++c)
+                {
+                    float value = src[c];
+                    if (epilogue.bias) value += epilogue.bias[k * out_block + c];
+                    if (epilogue.residual) value += epilogue.residual[image_offset + offset + c];
+                    image[offset + c] = activate(value, epilogue.activation, epilogue.clamp_min, epilogue.clamp_max);
+                }
+            }
+        }
     }
 }
 
+// out[b] (OC x OH*OW) = kernels (OC x C*K*K) * im2col[b], one GEMM per image
 void convolution(const vector<float>& im2col_data, int batch_size,
                  const vector<float>& kernels,
                  int out_channels, int kernel_size,
                  int out_height, int out_width,
-                 vector<float>& output){
+                 vector<float>& output, const ConvEpilogue& epilogue){
 
-    output.resize(batch_size * out_channels * out_height * out_width, 0.0f);
+    int out_size = out_height * out_width;
+    output.resize(static_cast<size_t>(batch_size) * out_channels * out_size);
+    if (batch_size <= 0 || out_size <= 0)
+    {
+        return;
+    }
+    // C from the filter bank; the lowered buffer must hold exactly C*K*K x OH*OW per image
+    size_t taps = static_cast<size_t>(kernel_size) * kernel_size;
+    int in_channels = static_cast<int>(kernels.size() / (out_channels * taps));
+    int col_size = in_channels * kernel_size * kernel_size;
+    assert(static_cast<size_t>(out_channels) * col_size == kernels.size());
+    assert(im2col_data.size() == static_cast<size_t>(batch_size) * col_size * out_size);
+    MatrixView<const float> weights(kernels.data(), out_channels, col_size, col_size);
     for (int b = 0; b < batch_size; ++b)
     {
-        for (int c = 0; c < out_channels; ++c)
-        {
-            for (int h = 0; h < out_height; ++h)
+        MatrixView<const float> lowered(im2col_data.data() + static_cast<size_t>(b) * col_size * out_size,
+                                        col_size, out_size, out_size);
+        size_t image_offset = static_cast<size_t>(b) * out_channels * out_size;
+        MatrixView<float> out(output.data() + image_offset, out_channels, out_size, out_size);
+        gemm(weights, lowered, out, image_epilogue(epilogue, image_offset, out_channels, out_size, out_size, true));
+    }
+}
+
+// Implicit GEMM: out[b] (OC x OH*OW) = kernels (OC x C*K*K) * X_b, where X_b is the
+// im2col matrix of image b. X_b is never built; the GEMM packing stage gathers each
+// row segment (one (c, kh, kw) tap over a run of output pixels) straight from input.
+void convolution_implicit(const float* input, int batch_size, int height, int width, int channels,
+                          const vector<float>& kernels, int out_channels, int kernel_size,
+                          int stride, int padding, vector<float>& output, const ConvEpilogue& epilogue)
+{
+    int out_height = (height + 2 * padding - kernel_size) / stride + 1;
+    int out_width = (width + 2 * padding - kernel_size) / stride + 1;
+    int out_size = out_height * out_width;
+    int col_size = channels * kernel_size * kernel_size;
+    output.resize(static_cast<size_t>(batch_size) * out_channels * out_size);
+
+    MatrixView<const float> weights(kernels.data(), out_channels, col_size, col_size);
+    for (int b = 0; b < batch_size; ++b)
+    {
+        const float* image = input + static_cast<size_t>(b) * channels * height * width;
+        GemmRowGather gather = [=](int k, int j0, int count, float* dst) {
+            int c = k / (kernel_size * kernel_size);
+            int kh = k / kernel_size % kernel_size;
+            int kw = k % kernel_size;
+            const float* plane = image + static_cast<size_t>(c) * height * width;
+            int oh = j0 / out_width;
+            int ow = j0 % out_width;
+            for (int n = 0; n < count; ++n)
             {
-                for (int w = 0; w < out_width; ++w)
+                int h_in = oh * stride + kh - padding;
+                int w_in = ow * stride + kw - padding;
+                bool inside = h_in >= 0 && h_in < height && w_in >= 0 && w_in < width;
+                dst[n] = inside ? plane[h_in * width + w_in] : 0.0f;
+                if (++ow == out_width) // Next output row
                 {
-                    for (int kh = 0; kh < kernel_size; ++kh)
-                    {
-                        for (int kw = 0; kw < kernel_size; ++kw)
-                        {
-                            int kernel_index = c * kernel_size * kernel_size + kh * kernel_size + kw; // Locate the point in kernel
-                            int im2col_index = b * out_height * out_width * (kernel_size * kernel_size) + (h * out_width + w) * (kernel_size * kernel_size) + (kh * kernel_size + kw); // Locate the point in the im2col data
-                            int output_index = b * out_channels * out_height * out_width + c * out_height * out_width + h * out_width + w;
-                            output[output_index] += im2col_data[im2col_index] * kernels[kernel_index];
-                        }
-                    }
+                    ow = 0;
+                    ++oh;
+                }
+            }
+        };
+        size_t image_offset = static_cast<size_t>(b) * out_channels * out_size;
+        MatrixView<float> out(output.data() + image_offset, out_channels, out_size, out_size);
+        gemm_implicit(weights, gather, out, image_epilogue(epilogue, image_offset, out_channels, out_size, out_size, true));
+    }
+}
+
+void convolution_forward(const float* input, int batch_size, int height, int width, int channels,
+                         const vector<float>& kernels, int out_channels, int kernel_size,
+                         int stride, int padding, vector<float>& output, ConvMode mode, TensorLayout layout,
+                         const ConvEpilogue& epilogue)
+{
+    if (layout != TensorLayout::NCHW) // Always lowered explicitly
+    {
+        convolution_blocked(input, batch_size, height, width, channels, kernels, out_channels,
+                            kernel_size, stride, padding, output, layout, epilogue);
+        return;
+    }
+    if (mode == ConvMode::IMPLICIT_GEMM)
+    {
+        convolution_implicit(input, batch_size, height, width, channels, kernels, out_channels,
+                             kernel_size, stride, padding, output, epilogue);
+        return;
+    }
+    int out_height = (height + 2 * padding - kernel_size) / stride + 1;
+    int out_width = (width + 2 * padding - kernel_size) / stride + 1;
+    thread_local vector<float> im2col_data; // Lowered input, reused across calls
+    im2col(input, batch_size, height, width, channels, kernel_size, stride, padding, im2col_data);
+    convolution(im2col_data, batch_size, kernels, out_channels, kernel_size, out_height, out_width, output, epilogue);
+}
+
+// Winograd F(m x m, 3 x 3) transforms: Y = AT [(G g GT) . (BT d B)] A over alpha x alpha input tiles
+template <int m> struct WinogradTransform;
+
+template <> struct WinogradTransform<2> {
+    static constexpr int alpha = 4;
+    static constexpr float BT[4][4] = {
+        {1, 0, -1, 0},
+        {0, 1, 1, 0},
+        {0, -1, 1, 0},
+        {0, 1, 0, -1}};
+    static constexpr float G[4][3] = {
+        {1, 0, 0},
+        {0.5f, 0.5f, 0.5f},
+        {0.5f, -0.5f, 0.5f},
+        {0, 0, 1}};
+    static constexpr float AT[2][4] = {
+        {1, 1, 1, 0},
+        {0, 1, -1, -1}};
+};
+
+template <> struct WinogradTransform<4> {
+    static constexpr int alpha = 6;
+    static constexpr float BT[6][6] = {
+        {4, 0, -5, 0, 1, 0},
+        {0, -4, -4, 1, 1, 0},
+        {0, 4, -4, -1, 1, 0},
+        {0, -2, -1, 2, 1, 0},
+        {0, 2, -1, -2, 1, 0},
+        {0, 4, 0, -5, 0, 1}};
+    static constexpr float G[6][3] = {
+        {1.0f / 4, 0, 0},
+        {-1.0f / 6, -1.0f / 6, -1.0f / 6},
+        {-1.0f / 6, 1.0f / 6, -1.0f / 6},
+        {1.0f / 24, 1.0f / 12, 1.0f / 6},
+        {1.0f / 24, -1.0f / 12, 1.0f / 6},
+        {0, 0, 1}};
+    static constexpr float AT[4][6] = {
+        {1, 1, 1, 1, 1, 0},
+        {0, 1, -1, 2, -2, 0},
+        {0, 1, 1, 4, 4, 0},
+        {0, 1, -1, 8, -8, 1}};
+};
+
+// U = G g GT for every (out channel, in channel) pair, scattered to [xi][oc][ic]
+template <int m>
+static void transform_filter(const float* kernels, int out_channels, int in_channels, vector<float>& U) {
+    using T = WinogradTransform<m>;
+    constexpr int alpha = T::alpha;
+    U.assign(alpha * alpha * out_channels * in_channels, 0.0f);
+    for (int oc = 0; oc < out_channels; ++oc) {
+        for (int ic = 0; ic < in_channels; ++ic) {
+            const float* g = kernels + (oc * in_channels + ic) * 9;
+            float Gg[alpha][3]; // G g
+            for (int i = 0; i < alpha; ++i)
+                for (int j = 0; j < 3; ++j)
+                    Gg[i][j] = T::G[i][0] * g[j] + T::G[i][1] * g[3 + j] + T::G[i][2] * g[6 + j];
+            for (int i = 0; i < alpha; ++i) {
+                for (int j = 0; j < alpha; ++j) {
+                    float u = Gg[i][0] * T::G[j][0] + Gg[i][1] * T::G[j][1] + Gg[i][2] * T::G[j][2]; // (G g) GT
+                    U[((i * alpha + j) * out_channels + oc) * in_channels + ic] = u;
                 }
             }
         }
     }
 }
 
-void convolution_winograd(const vector<float>& im2col_data, int batch_size,
-                          const vector<float>& kernels,
-                          int out_channels, int kernel_size,
-                          int out_height, int out_width,
-                          vector<float>& output) {
+WinogradFilter transformWinogradFilter(const vector<float>& kernels, int out_channels, int in_channels, int tile) {
+    WinogradFilter filter;
+    filter.tile = tile == 4 ? 4 : 2;
+    filter.out_channels = out_channels;
+    filter.in_channels = in_channels;
+    if (filter.tile == 4) {
+        transform_filter<4>(kernels.data(), out_channels, in_channels, filter.U);
+    } else {
+        transform_filter<2>(kernels.data(), out_channels, in_channels, filter.U);
+    }
+    return filter;
+}
+
+// At most WINOGRAD_CACHE_ENTRIES filters, keyed on buffer, shape and caller version (the weights
+// are never read on a hit); the least recently used entry is evicted
+static constexpr int WINOGRAD_CACHE_ENTRIES = 8;
+using WinogradFilterKey = tuple<const float*, size_t, int, int, int, uint64_t>;
+
+shared_ptr<const WinogradFilter> cachedWinogradFilter(const vector<float>& kernels, int out_channels, int in_channels,
+                                                      int tile, uint64_t version) {
+    WinogradFilterKey key(kernels.data(), kernels.size(), out_channels, in_channels, tile, version);
+    struct Entry {
+        WinogradFilterKey key;
+        shared_ptr<const WinogradFilter> filter;
+        uint64_t last_use = 0;
+    };
+    static mutex cache_mutex;
+    static Entry cache[WINOGRAD_CACHE_ENTRIES];
+    static uint64_t clock = 0;
 
-    output.resize(batch_size * out_channels * out_height * out_width, 0.0f);
-    for (int b = 0; b < batch_size; ++b) {
-        for (int c = 0; c < out_channels; ++c) {
-            for (int h = 0; h < out_height; h += 2) {
-                for (int w = 0; w < out_width; w += 2) {
-                    for (int k = 0; k < kernel_size * kernel_size; k += kernel_size) {
+    lock_guard<mutex> lock(cache_mutex);
+    Entry* victim = &cache[0];
+    for (Entry& entry : cache) {
+        if (entry.filter && entry.key == key) {
+            entry.last_use = ++clock;
+            return entry.filter;
+        }
+        if (entry.last_use < victim->last_use) {
+            victim = &entry;
+        }
+    }
+    // Evicted filters stay alive for callers still holding them
+    victim->key = key;
+    victim->filter = make_shared<const WinogradFilter>(transformWinogradFilter(kernels, out_channels, in_channels, tile));
+    victim->last_use = ++clock;
+    return victim->filter;
+}
 
-                    float D00 = im2col_data[b * out_height * out_width * 4 + (h * out_width + w) * 4]; // Compute D00 to D30
-                    float D10 = im2col_data[b * out_height * out_width * 4 + ((h + 1) * out_width + w) * 4];
-                    float D20 = im2col_data[b * out_height * out_width * 4 + (h * out_width + (w + 1)) * 4];
-                    float D30 = im2col_data[b * out_height * out_width * 4 + ((h + 1) * out_width + (w + 1)) * 4];
+// Tiles are processed in chunks so that the transformed inputs V ([xi][ic][tile])
+// and products M ([xi][oc][tile]) of one chunk stay in cache. For each chunk:
+//   input transform   V_xi = (BT d B)_xi for every tile and input channel
+//   element-wise stage M_xi = U_xi (OC x IC) * V_xi (IC x tiles), one GEMM per xi
+//   output transform  Y = AT M A, clipped to the output border
+template <int m>
+static void winograd_conv(const float* input, int batch_size, int height, int width, int channels,
+                          const WinogradFilter& filter, int padding, vector<float>& output, TensorLayout layout,
+                          const ConvEpilogue& epilogue) {
+    assert(filter.in_channels == channels);
+    using T = WinogradTransform<m>;
+    constexpr int alpha = T::alpha;
+    int out_channels = filter.out_channels;
+    int out_height = height + 2 * padding - 2;
+    int out_width = width + 2 * padding - 2;
+    output.assign(layout_size(layout, batch_size, out_channels, max(out_height, 0), max(out_width, 0)), 0.0f);
+    if (out_height <= 0 || out_width <= 0) {
+        return;
+    }
+    int tiles_h = (out_height + m - 1) / m;
+    int tiles_w = (out_width + m - 1) / m;
+    int tiles_per_image = tiles_h * tiles_w;
+    int tiles = batch_size * tiles_per_image;
 
-                    float k0 = kernels[c * kernel_size * kernel_size + k]; // Compute K0 to K2
-                    float k1 = kernels[c * kernel_size * kernel_size + k + 1];
-                    float k2 = kernels[c * kernel_size * kernel_size + k + 2];
+    // ~256K floats of V + M per chunk, a multiple of 16 tiles
+    int chunk = 256 * 1024 / (alpha * alpha * max(channels, out_channels));
+    chunk = max(16, chunk / 16 * 16);
+    int chunks = (tiles + chunk - 1) / chunk;
 
-                    float M0 = (D00 - D20) * k0; // Compute M0 to M3
-                    float M1 = (D10 + D20) * (k0 + k1 + k2) / 2.0f;
-                    float M2 = (D20 - D10) * (k0 - k1 + k2) / 2.0f;
-                    float M3 = (D10 - D30) * k2;
+    global_thread_pool().parallel_for(chunks, [&](int chunk_index) {
+        int t0 = chunk_index * chunk;
+        int nb = min(chunk, tiles - t0);
+        thread_local vector<float> V, M;
+        V.resize(static_cast<size_t>(alpha * alpha) * channels * nb);
+        M.resize(static_cast<size_t>(alpha * alpha) * out_channels * nb);
 
-                    float r0 = M0 + M1 + M2; // Compute r0 and r1 as the result. followed by formula
-                    float r1 = M1 - M2 - M3;
+        for (int t = 0; t < nb; ++t) {
+            int b = (t0 + t) / tiles_per_image;
+            int th = (t0 + t) % tiles_per_image / tiles_w;
+            int tw = (t0 + t) % tiles_w;
+            int h0 = th * m - padding; // top-left of the alpha x alpha input tile
+            int w0 = tw * m - padding;
+            for (int c = 0; c < channels; ++c) {
+                TensorPlane plane(input, layout, b, c, channels, height, width);
+                float d[alpha][alpha];
+                for (int i = 0; i < alpha; ++i) {
+                    for (int j = 0; j < alpha; ++j) {
+                        int h_in = h0 + i, w_in = w0 + j;
+                        bool inside = h_in >= 0 && h_in < height && w_in >= 0 && w_in < width;
+                        d[i][j] = inside ? plane.data[plane.offset(h_in, w_in)] : 0.0f;
+                    }
+                }
+                float BTd[alpha][alpha]; // BT d
+                for (int i = 0; i < alpha; ++i) {
+                    for (int j = 0; j < alpha; ++j) {
+                        float sum = 0.0f;
+                        for (int k = 0; k < alpha; ++k) sum += T::BT[i][k] * d[k][j];
+                        BTd[i][j] = sum;
+                    }
+                }
+                for (int i = 0; i < alpha; ++i) {
+                    for (int j = 0; j < alpha; ++j) {
+                        float sum = 0.0f;
+                        for (int k = 0; k < alpha; ++k) sum += BTd[i][k] * T::BT[j][k]; // (BT d) B
+                        V[(static_cast<size_t>(i * alpha + j) * channels + c) * nb + t] = sum;
+                    }
+                }
+            }
+        }
+
+        for (int xi = 0; xi < alpha * alpha; ++xi) {
+            MatrixView<const float> U_xi(filter.U.data() + static_cast<size_t>(xi) * out_channels * channels,
+                                         out_channels, channels, channels);
+            MatrixView<const float> V_xi(V.data() + static_cast<size_t>(xi) * channels * nb, channels, nb, nb);
+            MatrixView<float> M_xi(M.data() + static_cast<size_t>(xi) * out_channels * nb, out_channels, nb, nb);
+            gemm(U_xi, V_xi, M_xi);
+        }
 
-                    output[b * out_channels * out_height * out_width + c * out_height * out_width + h * out_width + w] += r0;
-                    output[b * out_channels * out_height * out_width + c * out_height * out_width + (h + 1) * out_width + w] += r1;
+        for (int t = 0; t < nb; ++t) {
+            int b = (t0 + t) / tiles_per_image;
+            int th = (t0 + t) % tiles_per_image / tiles_w;
+            int tw = (t0 + t) % tiles_w;
+            for (int oc = 0; oc < out_channels; ++oc) {
+                float ATM[m][alpha]; // AT M
+                for (int i = 0; i < m; ++i) {
+                    for (int j = 0; j < alpha; ++j) {
+                        float sum = 0.0f;
+                        for (int k = 0; k < alpha; ++k) {
+                            sum += T::AT[i][k] * M[(static_cast<size_t>(k * alpha + j) * out_channels + oc) * nb + t];
+                        }
+                        ATM[i][j] = sum;
+                    }
+                }
+                TensorPlane plane(output.data(), layout, b, oc, out_channels, out_height, out_width);
+                float bias = epilogue.bias ? epilogue.bias[oc] : 0.0f;
+                const float* residual = epilogue.residual ? epilogue.residual + (plane.data - output.data()) : nullptr;
+                for (int i = 0; i < m && th * m + i < out_height; ++i) {
+                    for (int j = 0; j < m && tw * m + j < out_width; ++j) {
+                        float sum = 0.0f;
+                        for (int k = 0; k < alpha; ++k) sum += ATM[i][k] * T::AT[j][k]; // (AT M) A
+                        size_t offset = plane.offset(th * m + i, tw * m + j);
+                        sum += bias + (residual ? residual[offset] : 0.0f); // Fused epilogue
+                        plane.data[offset] = activate(sum, epilogue.activation, epilogue.clamp_min, epilogue.clamp_max);
                     }
                 }
             }
         }
+    });
+}
+
+void convolution_winograd(const float* input, int batch_size, int height, int width, int channels,
+                          const WinogradFilter& filter, int padding, vector<float>& output, TensorLayout layout,
+                          const ConvEpilogue& epilogue) {
+    if (filter.tile == 4) {
+        winograd_conv<4>(input, batch_size, height, width, channels, filter, padding, output, layout, epilogue);
+    } else {
+        winograd_conv<2>(input, batch_size, height, width, channels, filter, padding, output, layout, epilogue);
+    }
+}
+
+// Im2col GEMM and Winograd F(4x4, 3x3) convolution timed in every layout over a set of
+// typical 3x3 layer shapes (batch 1, padding 1); the fastest layout per shape is reported.
+// Layout conversion of the input is timed separately. Rates count direct-convolution flops.
+void experiment_layouts()
+{
+    const int shapes[][3] = {{56, 3, 64}, {56, 64, 64}, {28, 128, 128}, {14, 256, 256}, {7, 512, 512}}; // H = W, C, OC
+    const TensorLayout layouts[] = {TensorLayout::NCHW, TensorLayout::NHWC, TensorLayout::NCHW8c, TensorLayout::NCHW16c};
+    for (const auto& shape : shapes)
+    {
+        int size = shape[0], channels = shape[1], out_channels = shape[2];
+        double flops = 2.0 * out_channels * channels * 9 * size * size;
+        double bytes = sizeof(float) * (static_cast<double>(channels + out_channels) * size * size +
+                                        static_cast<double>(out_channels) * channels * 9);
+        string dims = to_string(size) + "x" + to_string(size) + " " + to_string(channels) + "->" + to_string(out_channels);
+        vector<float> input(static_cast<size_t>(channels) * size * size);
+        vector<float> kernels(static_cast<size_t>(out_channels) * channels * 9);
+        for (auto& val : input) val = rand() / static_cast<float>(RAND_MAX);
+        for (auto& val : kernels) val = rand() / static_cast<float>(RAND_MAX);
+        WinogradFilter filter = transformWinogradFilter(kernels, out_channels, channels, 4); // Outside the timing
+
+        double best_time = 0.0;
+        const char* best_name = "";
+        for (TensorLayout layout : layouts)
+        {
+            vector<float> x, output;
+            string config = dims + " " + layout_name(layout);
+            bench_report(benchmark("convert_layout", config, [&] {
+                convert_layout(input.data(), TensorLayout::NCHW, x, layout, 1, channels, size, size);
+            }, 0.0, 2.0 * sizeof(float) * channels * size * size, bench_options(1, 5)));
+
+            const char* methods[] = {"conv_im2col", "conv_winograd"};
+            for (int method = 0; method < 2; ++method)
+            {
+                auto run = [&]() {
+                    if (method == 0)
+                        convolution_forward(x.data(), 1, size, size, channels, kernels, out_channels, 3, 1, 1,
+                                            output, ConvMode::EXPLICIT_IM2COL, layout);
+                    else
+                        convolution_winograd(x.data(), 1, size, size, channels, filter, 1, output, layout);
+                };
+                BenchResult result = benchmark(methods[method], config, run, flops, bytes, bench_options(1, 5));
+                double time = bench_report(result).median;
+                if (best_time == 0.0 || time < best_time)
+                {
+                    best_time = time;
+                    best_name = layout_name(layout);
+                }
+            }
+        }
+        printf("Fastest layout for %dx%d, %d -> %d channels: %s \n", size, size, channels, out_channels, best_name);
     }
 }
 
@@ -161,38 +757,38 @@ void convolution_winograd(const vector<float>& im2col_data, int batch_size,
 //     vector<float> im2col_data;
 //     im2col(input.data(), batch_size, height, width, channels, kernel_size, stride, padding, im2col_data); // Perform im2col
 //
-//     vector<float> output_normal;
-//     double sum_normal = 0.0;
+//     int out_height = (height + 2 * padding - kernel_size) / stride + 1;
+//     int out_width = (width + 2 * padding - kernel_size) / stride + 1;
+//     double flops = 2.0 * batch_size * out_channels * channels * kernel_size * kernel_size * out_height * out_width;
+//     double bytes = sizeof(float) * (input.size() + kernels.size() +
+//                                     static_cast<double>(batch_size) * out_channels * out_height * out_width);
+//     string config = to_string(height) + "x" + to_string(width) + " " + to_string(channels) + "->" + to_string(out_channels);
 //     cout << "im2col convert output size:" << im2col_data.size() << endl;
-//     for (int i = 0; i < k; ++i)
-//     {
-//         auto t = get_time();
-//         convolution(im2col_data, batch_size, kernels, out_channels, kernel_size,
-//                 (height + 2 * padding - kernel_size) / stride + 1,
-//                 (width + 2 * padding - kernel_size) / stride + 1,
-//                 output_normal);     // Perform convolution
-//         sum_normal += get_time() - t;
-//     }
 //
-//     cout << "Normal Conv Output size: " << output_normal.size() << endl;
-//     cout << "Process Finished !" << endl;
+//     vector<float> output_normal;
+//     bench_report(benchmark("conv_gemm", config, [&] {
+//         convolution(im2col_data, batch_size, kernels, out_channels, kernel_size, out_height, out_width,
+//                     output_normal);     // Perform convolution
+//     }, flops, bytes, bench_options(1, k)));
 //
 //     vector<float> output_winograd;
-//     double sum_winograd = 0.0;
-//     cout << "im2col convert output size:" << im2col_data.size() << endl;
-//     for (int i = 0; i < k; ++i)
-//     {
-//         auto t = get_time();
-//         convolution_winograd(im2col_data, batch_size, kernels, out_channels, kernel_size,
-//                              (height + 2 * padding - kernel_size) / stride + 1,
-//                              (width + 2 * padding - kernel_size) / stride + 1,
-//                              output_winograd); // Perform Winograd
-//         sum_winograd += get_time() - t;
-//     }
+//     WinogradFilter filter = transformWinogradFilter(kernels, out_channels, channels, 4); // G g GT computed once
+//     bench_report(benchmark("conv_winograd", config, [&] {
+//         convolution_winograd(input.data(), batch_size, height, width, channels,
+//                              filter, padding, output_winograd); // Perform Winograd F(4x4, 3x3)
+//     }, flops, bytes, bench_options(1, k)));
+//
+//     vector<float> output_implicit;
+//     bench_report(benchmark("conv_implicit", config, [&] {
+//         convolution_forward(input.data(), batch_size, height, width, channels, kernels, out_channels,
+//                             kernel_size, stride, padding, output_implicit, ConvMode::IMPLICIT_GEMM); // No im2col buffer
+//     }, flops, bytes, bench_options(1, k)));
+//
+//     cout << "Normal Conv Output size: " << output_normal.size() << endl;
 //     cout << "Winograd Conv Output size: " << output_winograd.size() << endl;
 //     cout << "Process Finished !" << endl;
 //
-//     cout  << "Normal Conv Running: " << sum_normal / k << endl; // Output Running time
-//     cout  << "Winograd Running: " << sum_winograd / k << endl; // Output Running time
+//     experiment_layouts(); // NCHW vs NHWC vs NCHWc per layer shape
+//     bench_write("conv_bench.json"); // Everything reported above, machine-readable
 //
 // }
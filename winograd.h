@@ -0,0 +1,111 @@
+//
+// im2col / GEMM / Winograd convolution on NCHW tensors.
+// Kernels are laid out [out_channels][in_channels][kernel_size][kernel_size].
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "gemm.h"
+
+// Activation tensor layouts. NCHW8c / NCHW16c are channel-blocked: [N][C / c][H][W][c],
+// with the channel count zero-padded to a multiple of c. NHWC is the same with c = C.
+enum class TensorLayout { NCHW, NHWC, NCHW8c, NCHW16c };
+
+const char* layout_name(TensorLayout layout);
+
+// Channel block c of a layout (1 for NCHW, channels for NHWC)
+int layout_channel_block(TensorLayout layout, int channels);
+
+// Floats held by a batch x channels x height x width tensor (channel padding included)
+size_t layout_size(TensorLayout layout, int batch_size, int channels, int height, int width);
+
+// One channel plane of a tensor in any layout: element (h, w) is data[offset(h, w)]
+struct TensorPlane {
+    float* data;
+    int width;
+    int block;
+
+    TensorPlane(const float* tensor, TensorLayout layout, int b, int c, int channels, int height, int width)
+        : width(width), block(layout_channel_block(layout, channels)) {
+        int blocks = (channels + block - 1) / block;
+        data = const_cast<float*>(tensor) +
+               (static_cast<size_t>(b) * blocks + c / block) * block * height * width + c % block;
+    }
+
+    size_t offset(int h, int w) const { return (static_cast<size_t>(h) * width + w) * block; }
+};
+
+// Re-lay a tensor out (blocked 8 x 8 transposes / contiguous channel runs)
+void convert_layout(const float* src, TensorLayout from, std::vector<float>& dst, TensorLayout to,
+                    int batch_size, int channels, int height, int width);
+
+// Fused into the output store of every conv below:
+// out = act(conv + bias[oc] + residual), with no extra pass over the output
+struct ConvEpilogue {
+    const float* bias = nullptr;      // One per output channel
+    const float* residual = nullptr;  // Tensor shaped and laid out like the output
+    Activation activation = Activation::NONE;
+    float clamp_min = 0.0f;           // CLAMP bounds
+    float clamp_max = 6.0f;
+};
+
+// Lowered input per image: (C*K*K) x (OH*OW), row (c, kh, kw), column (oh, ow)
+void im2col(const float* input, int batch_size, int height, int width, int channels,
+            int kernel_size, int stride, int padding,
+            std::vector<float>& output);
+
+// Any layout. NHWC / NCHWc lower to (OH*OW) x (C/c*K*K*c): row (oh, ow), column (channel block, kh, kw, c)
+void im2col(const float* input, int batch_size, int height, int width, int channels,
+            int kernel_size, int stride, int padding,
+            std::vector<float>& output, TensorLayout layout);
+
+// GEMM over the im2col matrix: out (OC x OH*OW) = kernels (OC x C*K*K) * lowered per image.
+// C is taken from kernels.size(); both buffers must match it (asserted)
+void convolution(const std::vector<float>& im2col_data, int batch_size,
+                 const std::vector<float>& kernels,
+                 int out_channels, int kernel_size,
+                 int out_height, int out_width,
+                 std::vector<float>& output, const ConvEpilogue& epilogue = ConvEpilogue());
+
+// EXPLICIT_IM2COL lowers the whole input with im2col first; IMPLICIT_GEMM computes
+// the im2col addresses inside the packed GEMM tiles and never allocates the lowered matrix
+// (NCHW only: the channel-blocked layouts are always lowered explicitly)
+enum class ConvMode { EXPLICIT_IM2COL, IMPLICIT_GEMM };
+
+void convolution_implicit(const float* input, int batch_size, int height, int width, int channels,
+                          const std::vector<float>& kernels, int out_channels, int kernel_size,
+                          int stride, int padding, std::vector<float>& output,
+                          const ConvEpilogue& epilogue = ConvEpilogue());
+
+void convolution_forward(const float* input, int batch_size, int height, int width, int channels,
+                         const std::vector<float>& kernels, int out_channels, int kernel_size,
+                         int stride, int padding, std::vector<float>& output,
+                         ConvMode mode = ConvMode::IMPLICIT_GEMM, TensorLayout layout = TensorLayout::NCHW,
+                         const ConvEpilogue& epilogue = ConvEpilogue());
+
+// 3x3 filter bank transformed for Winograd F(tile x tile, 3 x 3), tile = 2 or 4
+struct WinogradFilter {
+    int tile = 2;
+    int out_channels = 0;
+    int in_channels = 0;
+    std::vector<float> U; // G g GT, laid out [(tile + 2)^2][out_channels][in_channels]
+};
+
+WinogradFilter transformWinogradFilter(const std::vector<float>& kernels, int out_channels, int in_channels, int tile);
+
+// Transformed filter from a small process-wide LRU cache, looked up by buffer, shape and
+// `version` without reading the weights. The version is the caller's handle on the contents:
+// it must change whenever the weights change in place or the buffer is reused for another bank
+std::shared_ptr<const WinogradFilter> cachedWinogradFilter(const std::vector<float>& kernels, int out_channels,
+                                                           int in_channels, int tile, uint64_t version);
+
+// Stride-1 3x3 convolution with Winograd F(2x2, 3x3) or F(4x4, 3x3). The filter is transformed
+// once by the caller (transformWinogradFilter / cachedWinogradFilter) and must have `channels`
+// input channels. Input and output share `layout`
+void convolution_winograd(const float* input, int batch_size, int height, int width, int channels,
+                          const WinogradFilter& filter, int padding, std::vector<float>& output,
+                          TensorLayout layout = TensorLayout::NCHW, const ConvEpilogue& epilogue = ConvEpilogue());